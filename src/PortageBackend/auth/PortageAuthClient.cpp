@@ -4,6 +4,7 @@
  */
 
 #include "PortageAuthClient.h"
+#include "../config/PortageConfigIndex.h"
 #include <KAuth/Action>
 #include <KAuth/ExecuteJob>
 #include <QDebug>
@@ -208,9 +209,16 @@ void PortageAuthClient::executeAction(const QString &actionName,
         });
     }
     
+    // package.* and file writes change what PortageConfigIndex holds
+    const QString helperAction = args.value(QStringLiteral("action")).toString();
+    const bool writesConfig = helperAction.startsWith(QLatin1String("package.")) || helperAction == QLatin1String("file.write");
+    
     // Handle completion
     connect(job, &KAuth::ExecuteJob::result, this,
-           [this, callback, actionName](KJob *kjob) {
+           [this, callback, actionName, writesConfig](KJob *kjob) {
+        if (writesConfig && kjob->error() == 0) {
+            PortageConfigIndex::instance().invalidate();
+        }
         handleJobResult(static_cast<KAuth::ExecuteJob *>(kjob), callback, actionName);
     });
     
@@ -5,18 +5,26 @@
 
 #include "PortageBackend.h"
 #include "PortageQmlInjector.h"
+#include "PortageResultsStream.h"
+#include "PortageUpdateChecker.h"
 #include "../resources/PortageResource.h"
+#include "../resources/PortageUseFlags.h"
 #include "../transaction/PortageTransaction.h"
 #include "../dialogs/UseFlagsDialog.h"
 #include "../repository/PortageSourcesBackend.h"
 #include "../utils/QmlEngineUtils.h"
 
 #include <Category/Category.h>
+#include <Transaction/TransactionModel.h>
 #include <resources/StandardBackendUpdater.h>
 #include <KLocalizedString>
 #include <KPluginFactory>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QThreadPool>
 #include <QTimer>
+#include <QtConcurrent>
 #include <QInputDialog>
 #include <QQmlEngine>
 #include <QJSEngine>
@@ -24,25 +32,77 @@
 #include <QCoreApplication>
 #include <QWindow>
 #include "repository/PortageRepositoryReader.h"
+#include "repository/PortageRepositoryConfig.h"
 #include "installed/PortageInstalledReader.h"
+#include "installed/PortageVdbWatcher.h"
+#include "repository/PortageMetadataCache.h"
+#include "repository/PortageMetadataXml.h"
+#include "repository/PortageRepositoryIndex.h"
+#include "repository/PortageVersionIndex.h"
+#include "cache/PortageCatalogCache.h"
+#include "cache/UseFlagInfoCache.h"
 #include <resources/SourcesModel.h>
 
 DISCOVER_BACKEND_PLUGIN(PortageBackend)
 
 PortageBackend::PortageBackend(QObject *parent)
     : AbstractResourcesBackend(parent)
+    , m_searchIndex(m_store)
+    , m_categoryTreeRevision(0)
     , m_updater(new StandardBackendUpdater(this))
     , m_qmlInjector(new PortageQmlInjector(this))
     , m_sourcesBackend(new PortageSourcesBackend(this))
     , m_initialized(false)
+    , m_repoReader(nullptr)
+    , m_vdbWatcher(new PortageVdbWatcher(this))
+    , m_sweepTimer(new QTimer(this))
+    , m_checkingUpdates(false)
+    , m_updateCheckPending(false)
+    , m_updatingTextIndex(false)
+    , m_textIndexPending(false)
+    , m_generation(0)
+    , m_contentsTimer(new QTimer(this))
+    , m_loading(false)
+    , m_installedLoaded(false)
+    , m_reloading(false)
+    , m_reloadPending(false)
+    , m_pendingLoadParts(0)
+    , m_repoProgress(0)
+    , m_loadProgress(100)
 {
     qDebug() << "Portage: Initializing backend";
     
-    // Load all packages (repository + installed)
-    loadPackages();
+    // Coalesce contentsChanged() while packages stream in
+    m_contentsTimer->setSingleShot(true);
+    m_contentsTimer->setInterval(250);
+    connect(m_contentsTimer, &QTimer::timeout, this, &PortageBackend::contentsChanged);
+    
+    // Resources nobody asked for in a while give back their lazily loaded metadata, later themselves
+    m_sweepTimer->setInterval(SWEEP_INTERVAL_MS);
+    connect(m_sweepTimer, &QTimer::timeout, this, &PortageBackend::sweepIdleResources);
+    m_sweepTimer->start();
+    
+    // Merges and unmerges, from Discover or from a terminal
+    connect(m_vdbWatcher, &PortageVdbWatcher::categoriesChanged, this, &PortageBackend::refreshInstalledCategories);
+    
+    // A valid snapshot is cheap enough to apply right away,
+    // otherwise scan in the background and keep the UI responsive
+    PortageCatalogCache cache;
+    recordLoadStamps();
+    if (cache.load()) {
+        setRepositoryAtoms(cache.repositoryAtoms());
+        m_installedInfo = cache.installedPackages();
+        addRepositoryPackages(cache.repositoryPackages().values());
+        addInstalledPackages(m_installedInfo);
+        qDebug() << "Portage: Backend initialized from snapshot with" << m_store.size() << "packages";
+        logStoreUsage();
+        startUpdateCheck();
+        updateTextIndex();
+    } else {
+        startLoading();
+    }
     
     m_initialized = true;
-    qDebug() << "Portage: Backend initialized with" << m_resources.size() << "packages";
     
     // Register our sources backend
     SourcesModel::global()->addSourcesBackend(m_sourcesBackend);
@@ -82,67 +142,77 @@ QString PortageBackend::displayName() const
     return QStringLiteral("Portage");
 }
 
-void PortageBackend::populateTestPackages()
-{
-    auto firefox = new PortageResource(
-        QStringLiteral("www-client/firefox"),
-        QStringLiteral("firefox"),
-        QStringLiteral("Mozilla Firefox Web Browser"),
-        this
-    );
-    firefox->setState(AbstractResource::Installed);
-    firefox->setInstalledVersion(QStringLiteral("115.0"));
-    firefox->setAvailableVersion(QStringLiteral("120.0"));
-    firefox->setSize(200 * 1024 * 1024);
-    m_resources.insert(firefox->packageName().toLower(), firefox);
-    
-    auto vlc = new PortageResource(
-        QStringLiteral("media-video/vlc"),
-        QStringLiteral("vlc"),
-        QStringLiteral("VLC media player"),
-        this
-    );
-    vlc->setState(AbstractResource::None);
-    vlc->setAvailableVersion(QStringLiteral("3.0.20"));
-    vlc->setSize(50 * 1024 * 1024);
-    m_resources.insert(vlc->packageName().toLower(), vlc);
-    
-    auto gimp = new PortageResource(
-        QStringLiteral("media-gfx/gimp"),
-        QStringLiteral("gimp"),
-        QStringLiteral("GNU Image Manipulation Program"),
-        this
-    );
-    gimp->setState(AbstractResource::Upgradeable);
-    gimp->setInstalledVersion(QStringLiteral("2.10.34"));
-    gimp->setAvailableVersion(QStringLiteral("2.10.36"));
-    gimp->setSize(120 * 1024 * 1024);
-    m_resources.insert(gimp->packageName().toLower(), gimp);
-    
-    qDebug() << "Portage: Created test packages: firefox, vlc, gimp";
-}
-
 ResultsStream *PortageBackend::search(const AbstractResourcesBackend::Filters &filter)
 {
-    QVector<AbstractResource *> results;
+    // Match against the store, only packages that get sent out become a PortageResource
+    QList<PortagePackageStore::Id> matches;
+    QList<uint> scores;
+    bool textSearch = false;
     
-    if (!filter.search.isEmpty()) {
-        const QString searchTerm = filter.search.toLower();
-        for (auto *res : m_resources) {
-            if (res->name().toLower().contains(searchTerm) ||
-                res->packageName().toLower().contains(searchTerm) ||
-                res->comment().toLower().contains(searchTerm)) {
-                results << res;
+    if (filter.state == AbstractResource::Upgradeable) {
+        // The updater asks for these, it's whatever the last update check found
+        matches = m_updates.keys();
+    }
+    else if (!filter.search.isEmpty()) {
+        textSearch = true;
+        QElapsedTimer timer;
+        timer.start();
+        
+        QList<PortageSearchIndex::Match> found = m_searchIndex.search(filter.search);
+        
+        // Nothing by name, maybe it was misspelled ("libreofice")
+        if (found.isEmpty() && !filter.search.contains(QLatin1Char('/')) && !filter.search.contains(QLatin1Char(' '))) {
+            QElapsedTimer fuzzyTimer;
+            fuzzyTimer.start();
+            found = m_searchIndex.fuzzySearch(filter.search);
+            qDebug() << "Portage: Fuzzy search for" << filter.search << "found" << found.size() << "packages in"
+                     << fuzzyTimer.nsecsElapsed() / 1000 << "us";
+        }
+        
+        matches.reserve(found.size());
+        scores.reserve(found.size());
+        for (const PortageSearchIndex::Match &match : found) {
+            matches << match.id;
+            scores << PortageSearchIndex::sortScore(match);
+        }
+        
+        // Descriptions, ranked below every name, summary and fuzzy match
+        if (filter.search.size() >= 3) {
+            const QList<PortageTextIndex::Hit> hits = m_textIndex.search(filter.search);
+            const QSet<PortagePackageStore::Id> named(matches.cbegin(), matches.cend());
+            for (const PortageTextIndex::Hit &hit : hits) {
+                const PortagePackageStore::Id id = m_store.find(hit.atom);
+                if (id == PortagePackageStore::InvalidId || named.contains(id)) {
+                    continue;
+                }
+                matches << id;
+                scores << 1 + uint(14 * hit.score / hits.first().score);
             }
         }
+        qDebug() << "Portage: Search for" << filter.search << "matched" << matches.size() << "packages in"
+                 << timer.nsecsElapsed() / 1000 << "us";
     }
     else if (filter.category) {
         const auto categories = filter.category->involvedCategories();
-        for (auto *res : m_resources) {
+        if (categories.contains(QStringLiteral("portage_packages"))) {
+            matches.reserve(m_store.size());
+            for (PortagePackageStore::Id id = 0; id < m_store.idCount(); ++id) {
+                if (m_store.contains(id)) {
+                    matches << id;
+                }
+            }
+        } else {
+            // Straight from the per-category lists, categories don't overlap
             for (const auto &cat : categories) {
-                if (res->hasCategory(cat)) {
-                    results << res;
-                    break;
+                const quint16 categoryId = m_store.findCategory(cat);
+                if (categoryId == PortagePackageStore::NoCategory) {
+                    continue;
+                }
+                const QList<PortagePackageStore::Id> &members = m_store.categoryMembers(categoryId);
+                for (PortagePackageStore::Id id : members) {
+                    if (m_store.contains(id)) {
+                        matches << id;
+                    }
                 }
             }
         }
@@ -152,52 +222,37 @@ ResultsStream *PortageBackend::search(const AbstractResourcesBackend::Filters &f
         // Return empty or limited results
         // TODO: return popular packages or recently updated packages
     }
-
-    auto stream = new ResultsStream(QStringLiteral("Portage-search"));
     
-    if (results.isEmpty()) {
-        QTimer::singleShot(0, stream, [stream]() {
-            stream->finish();
-        });
-        return stream;
+    // A new text search supersedes the previous one, whose remaining pages are dropped
+    if (textSearch && m_textStream) {
+        m_textStream->cancel();
     }
     
-    // Send results in batches to avoid UI freeze
-    const int batchSize = 100;
-    int totalBatches = (results.size() + batchSize - 1) / batchSize;
-    
-    for (int i = 0; i < results.size(); i += batchSize) {
-        QVector<StreamResult> batch;
-        for (int j = i; j < qMin(i + batchSize, results.size()); ++j) {
-            batch << results[j];
-        }
-        
-        int batchNum = i / batchSize;
-        bool isLast = (batchNum == totalBatches - 1);
-        
-        QTimer::singleShot(batchNum * 10, stream, [stream, batch, isLast]() {
-            Q_EMIT stream->resourcesFound(batch);
-            if (isLast) {
-                stream->finish();
-            }
-        });
+    // Pages are produced on demand, the updater needs the whole list at once
+    const auto mode = filter.state == AbstractResource::Upgradeable ? PortageResultsStream::Mode::All
+                                                                    : PortageResultsStream::Mode::OnDemand;
+    auto stream = new PortageResultsStream(this, matches, scores, mode);
+    if (textSearch) {
+        m_textStream = stream;
     }
+    m_streams << stream;
     
     return stream;
 }
 
 QList<std::shared_ptr<Category>> PortageBackend::category() const
 {
+    // Only rebuilt when a category appears or disappears
+    if (m_categoryTreeRevision == m_store.categoriesRevision() && !m_categoryTree.isEmpty()) {
+        return m_categoryTree;
+    }
+    m_categoryTreeRevision = m_store.categoriesRevision();
+    
     // Root category (all Portage packages)
     CategoryFilter rootFlt{CategoryFilter::FilterType::CategoryNameFilter, QLatin1String("portage_packages")};
 
-    // Collect unique portage categories (the part before the slash)
-    QSet<QString> portageCats;
-    for (PortageResource *res : m_resources.values()) {
-        const QString cat = res->section();
-        if (!cat.isEmpty())
-            portageCats.insert(cat);
-    }
+    // Portage categories that currently have packages
+    const QStringList portageCats = m_store.categories();
 
     // Create child categories for each portage category
     QList<std::shared_ptr<Category>> children;
@@ -229,18 +284,13 @@ QList<std::shared_ptr<Category>> PortageBackend::category() const
         false); // isAddons = false for old versions
 #endif
 
-    return {root};
+    m_categoryTree = {root};
+    return m_categoryTree;
 }
 
 int PortageBackend::updatesCount() const
 {
-    int count = 0;
-    for (auto *res : m_resources) {
-        if (res->state() == AbstractResource::Upgradeable) {
-            count++;
-        }
-    }
-    return count;
+    return m_updates.size();
 }
 
 bool PortageBackend::showInstallDialogs(PortageResource *portageRes)
@@ -313,8 +363,202 @@ AbstractBackendUpdater *PortageBackend::backendUpdater() const
 
 void PortageBackend::checkForUpdates()
 {
-    qDebug() << "Portage: checkForUpdates() stub";
+    startUpdateCheck();
+}
+
+void PortageBackend::startUpdateCheck()
+{
+    if (m_loading || m_reloading || m_checkingUpdates) {
+        // Runs again once the load or the running check is done
+        m_updateCheckPending = true;
+        return;
+    }
+    m_updateCheckPending = false;
+    
+    // Everything the workers need is copied here, they don't touch the store
+    PortageRepositoryConfig &config = PortageRepositoryConfig::instance();
+    QList<QPair<QString, QString>> repositories;
+    for (const QString &repo : std::as_const(m_repoOrder)) {
+        repositories << qMakePair(repo, config.getRepositoryLocation(repo));
+    }
+    
+    QList<UpdateCandidate> candidates;
+    candidates.reserve(m_installedInfo.size());
+    for (auto it = m_installedInfo.constBegin(); it != m_installedInfo.constEnd(); ++it) {
+        const PortagePackageStore::Id id = m_store.find(it.key());
+        if (id == PortagePackageStore::InvalidId || !m_store.hasFlag(id, PortagePackageStore::InRepository)) {
+            continue;
+        }
+        
+        UpdateCandidate candidate;
+        candidate.atom = m_store.atom(id);
+        for (const auto &repo : std::as_const(repositories)) {
+            const auto atoms = m_repoAtoms.constFind(repo.first);
+            if (atoms != m_repoAtoms.constEnd() && atoms.value().contains(id)) {
+                candidate.repositories << repo;
+            }
+        }
+        
+        // Every installed slot is compared against its own best version
+        QHash<QString, QString> slots = it.value().installedSlots;
+        if (slots.isEmpty()) {
+            slots.insert(it.value().slot, it.value().version);
+        }
+        for (auto slot = slots.constBegin(); slot != slots.constEnd(); ++slot) {
+            candidate.slot = slot.key();
+            candidate.installedVersion = slot.value();
+            candidates << candidate;
+        }
+    }
+    
+    qDebug() << "Portage: Checking" << candidates.size() << "installed packages for updates";
+    m_checkingUpdates = true;
+    updateLoadProgress();
+    
+    QElapsedTimer timer;
+    timer.start();
+    auto *watcher = new QFutureWatcher<QHash<QString, QString>>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, timer]() {
+        qDebug() << "Portage: Update check took" << timer.elapsed() << "ms";
+        applyUpdates(watcher->result());
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::run([candidates]() {
+        return PortageUpdateChecker::findUpdates(candidates);
+    }));
+}
+
+void PortageBackend::updateTextIndex()
+{
+    if (m_loading || m_reloading || m_updatingTextIndex) {
+        m_textIndexPending = true;
+        return;
+    }
+    m_textIndexPending = false;
+    
+    PortageRepositoryConfig &config = PortageRepositoryConfig::instance();
+    QList<QPair<QString, QString>> repositories;
+    for (const QString &repo : std::as_const(m_repoOrder)) {
+        repositories << qMakePair(repo, config.getRepositoryLocation(repo));
+    }
+    
+    // The worker updates a copy, searches keep using the current index meanwhile
+    m_updatingTextIndex = true;
+    auto *watcher = new QFutureWatcher<PortageTextIndex>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher]() {
+        m_textIndex = watcher->result();
+        m_updatingTextIndex = false;
+        watcher->deleteLater();
+        qDebug() << "Portage: Description index has" << m_textIndex.documentCount() << "packages and"
+                 << m_textIndex.termCount() << "terms";
+        if (m_textIndexPending) {
+            updateTextIndex();
+        }
+    });
+    watcher->setFuture(QtConcurrent::run([index = m_textIndex, repositories]() mutable {
+        if (index.documentCount() == 0) {
+            index.load();
+        }
+        if (index.update(repositories)) {
+            index.save();
+        }
+        return index;
+    }));
+}
+
+void PortageBackend::applyUpdates(const QHash<QString, QString> &updates)
+{
+    m_checkingUpdates = false;
+    
+    QHash<PortagePackageStore::Id, QString> found;
+    for (auto it = updates.constBegin(); it != updates.constEnd(); ++it) {
+        const PortagePackageStore::Id id = m_store.find(it.key());
+        // Unmerged while the check was running
+        if (id != PortagePackageStore::InvalidId && m_store.hasFlag(id, PortagePackageStore::Installed)) {
+            found.insert(id, it.value());
+        }
+    }
+    
+    // Up to date now
+    for (auto it = m_updates.constBegin(); it != m_updates.constEnd(); ++it) {
+        if (found.contains(it.key()) || !m_store.contains(it.key())) {
+            continue;
+        }
+        m_store.setFlag(it.key(), PortagePackageStore::Upgradeable, false);
+        if (PortageResource *r = materializedResource(it.key())) {
+            r->setUpgradeVersion(QString());
+            Q_EMIT resourcesChanged(r, {"state", "availableVersion"});
+        }
+    }
+    
+    // New or newer updates
+    for (auto it = found.constBegin(); it != found.constEnd(); ++it) {
+        m_store.setFlag(it.key(), PortagePackageStore::Upgradeable);
+        if (m_updates.value(it.key()) == it.value()) {
+            continue;
+        }
+        if (PortageResource *r = resourceForId(it.key())) {
+            r->setUpgradeVersion(it.value());
+            Q_EMIT resourcesChanged(r, {"state", "availableVersion"});
+        }
+    }
+    
+    m_updates = found;
+    qDebug() << "Portage: Found" << m_updates.size() << "updates";
+    m_updateUse.removeIf([this](const QHash<PortagePackageStore::Id, UpgradeUse>::iterator it) {
+        return m_updates.value(it.key()) != it.value().version;
+    });
+    
+    updateLoadProgress();
     Q_EMIT updatesCountChanged();
+    predictUpdateUse();
+    
+    if (m_updateCheckPending) {
+        startUpdateCheck();
+    }
+}
+
+void PortageBackend::predictUpdateUse()
+{
+    // package.use may have changed since the last check, so every update is predicted again
+    if (m_updateUseWatcher) {
+        m_updateUseWatcher->cancel();
+    }
+    QList<PortageUseFlags::EffectiveUseRequest> requests;
+    for (auto it = m_updates.constBegin(); it != m_updates.constEnd(); ++it) {
+        requests << PortageUseFlags::EffectiveUseRequest{m_store.atom(it.key()), it.value(), false};
+    }
+    if (requests.isEmpty()) {
+        return;
+    }
+    
+    QElapsedTimer timer;
+    timer.start();
+    auto *watcher = new QFutureWatcher<PortageUseFlags::EffectiveUseFlags>(this);
+    m_updateUseWatcher = watcher;
+    // Results arrive one package at a time, each update row fills in as soon as its own is ready
+    connect(watcher, &QFutureWatcherBase::resultReadyAt, this, [this, watcher](int index) {
+        const PortageUseFlags::EffectiveUseFlags result = watcher->resultAt(index);
+        const PortagePackageStore::Id id = m_store.find(result.atom);
+        // Checked again or merged meanwhile
+        if (id == PortagePackageStore::InvalidId || m_updates.value(id) != result.version) {
+            return;
+        }
+        const UpgradeUse use{result.version, UseFlagSet::fromFlags(result.enabled), UseFlagSet::fromFlags(result.disabled)};
+        m_updateUse.insert(id, use);
+        if (PortageResource *r = materializedResource(id)) {
+            r->setUpgradeUse(use.enabled, use.disabled);
+            Q_EMIT resourcesChanged(r, {"upgradeUseChanges"});
+        }
+    });
+    connect(watcher, &QFutureWatcherBase::finished, this, [watcher, timer]() {
+        if (!watcher->isCanceled()) {
+            qDebug() << "Portage: Predicted USE for" << watcher->future().resultCount() << "updates in"
+                     << timer.elapsed() << "ms";
+        }
+        watcher->deleteLater();
+    });
+    watcher->setFuture(PortageUseFlags::computeEffectiveUseFlagsBatch(requests));
 }
 
 Transaction *PortageBackend::installApplication(AbstractResource *app)
@@ -349,77 +593,682 @@ Transaction *PortageBackend::removeApplication(AbstractResource *app)
     return new PortageTransaction(qobject_cast<PortageResource *>(app), Transaction::RemoveRole);
 }
 
-void PortageBackend::loadPackages()
+void PortageBackend::startLoading()
 {
-    qDebug() << "Portage: Loading packages from repositories";
+    qDebug() << "Portage: Loading packages in background";
+    
+    m_loading = true;
+    m_installedLoaded = false;
+    m_pendingLoadParts = 2;
+    m_repoProgress = 0;
+    updateLoadProgress();
+    recordLoadStamps();
+    
+    // Installed packages: whole /var/db/pkg scan on a worker thread
+    auto *installedWatcher = new QFutureWatcher<QHash<QString, InstalledPackageInfo>>(this);
+    connect(installedWatcher, &QFutureWatcherBase::finished, this, [this, installedWatcher]() {
+        onInstalledLoaded(installedWatcher->result());
+        installedWatcher->deleteLater();
+    });
+    installedWatcher->setFuture(QtConcurrent::run([]() {
+        PortageInstalledReader reader(nullptr);
+        reader.loadInstalledPackages();
+        return reader.installedPackagesInfo();
+    }));
+    
+    // Repository packages: categories are scanned on the thread pool and streamed in
+    m_repoReader = new PortageRepositoryReader(this, this);
+    connect(m_repoReader, &PortageRepositoryReader::packagesFound, this, &PortageBackend::onRepositoryPackagesFound);
+    connect(m_repoReader, &PortageRepositoryReader::progressChanged, this, [this](int done, int total) {
+        m_repoProgress = total > 0 ? done * 100 / total : 100;
+        updateLoadProgress();
+    });
+    connect(m_repoReader, &PortageRepositoryReader::packagesLoaded, this, &PortageBackend::onLoadPartFinished);
+    m_repoReader->loadRepositoryAsync();
+}
+
+void PortageBackend::onInstalledLoaded(const QHash<QString, InstalledPackageInfo> &installedInfo)
+{
+    qDebug() << "Portage: Publishing" << installedInfo.size() << "installed packages";
+    
+    m_installedInfo = installedInfo;
+    addInstalledPackages(installedInfo);
+    m_installedLoaded = true;
+    
+    // Repository packages that arrived in the meantime
+    addRepositoryPackages(m_pendingRepoEntries);
+    m_pendingRepoEntries.clear();
+    
+    updateLoadProgress();
+    Q_EMIT contentsChanged();
+    onLoadPartFinished();
+}
+
+void PortageBackend::onRepositoryPackagesFound(const QList<RepositoryPackageEntry> &entries)
+{
+    if (!m_installedLoaded) {
+        m_pendingRepoEntries << entries;
+        return;
+    }
+    
+    addRepositoryPackages(entries);
+    scheduleContentsChanged();
+}
+
+void PortageBackend::onLoadPartFinished()
+{
+    if (--m_pendingLoadParts > 0) {
+        return;
+    }
+    
+    // Both scans joined, persist the result off the GUI thread
+    setRepositoryAtoms(m_repoReader->repositoryAtoms());
+    saveSnapshot();
+    
+    m_repoReader->deleteLater();
+    m_repoReader = nullptr;
+    m_loading = false;
+    m_repoProgress = 100;
+    updateLoadProgress();
+    
+    m_contentsTimer->stop();
+    Q_EMIT contentsChanged();
+    qDebug() << "Portage: Backend initialized with" << m_store.size() << "packages";
+    logStoreUsage();
     
-    // Load repository packages first
-    PortageRepositoryReader repoReader(this, this);
-    repoReader.loadRepository();
-    const auto repoPackages = repoReader.packages();
+    if (!m_pendingVdbCategories.isEmpty()) {
+        refreshInstalledCategories(m_pendingVdbCategories.values());
+        m_pendingVdbCategories.clear();
+    }
     
-    // Collect known atoms for better version parsing
-    QSet<QString> knownAtoms;
-    for (auto it = repoPackages.constBegin(); it != repoPackages.constEnd(); ++it) {
-        PortageResource *r = it.value();
-        // insert by atom (category/package, lowercase)
-        QString atom = r->atom().toLower();
-        m_resources.insert(atom, r);
-        knownAtoms.insert(atom);
+    if (m_reloadPending) {
+        m_reloadPending = false;
+        reloadPackages();
     }
+    
+    startUpdateCheck();
+    updateTextIndex();
+}
 
-    // Load installed packages and update resource states
-    PortageInstalledReader instReader(this, this);
-    instReader.setKnownPackages(knownAtoms); // Pass known packages for better parsing
-    instReader.loadInstalledPackages();
-    const auto installed = instReader.installedVersions();
-    const auto installedInfo = instReader.installedPackagesInfo();
+void PortageBackend::updateLoadProgress()
+{
+    // /var/db/pkg is a small part of the work compared to the repositories
+    int progress = 100;
+    if (m_loading) {
+        progress = (m_installedLoaded ? 20 : 0) + m_repoProgress * 80 / 100;
+        progress = qMin(progress, 99);
+    } else if (m_checkingUpdates) {
+        // No useful steps to report, a warm check takes a fraction of a second
+        progress = 50;
+    }
     
+    if (progress != m_loadProgress) {
+        m_loadProgress = progress;
+        Q_EMIT fetchingUpdatesProgressChanged();
+    }
+}
+
+void PortageBackend::scheduleContentsChanged()
+{
+    if (!m_contentsTimer->isActive()) {
+        m_contentsTimer->start();
+    }
+}
+
+void PortageBackend::addRepositoryPackages(const QList<RepositoryPackageEntry> &entries)
+{
+    for (const RepositoryPackageEntry &entry : entries) {
+        const PortagePackageStore::Id id = m_store.insert(entry.atom);
+        if (id == PortagePackageStore::InvalidId) {
+            continue;
+        }
+        m_store.setFlag(id, PortagePackageStore::InRepository);
+        
+        // Installed packages keep the repository they were built from
+        if (!m_store.hasFlag(id, PortagePackageStore::Installed)) {
+            m_store.setRepository(id, entry.repository);
+            if (PortageResource *r = materializedResource(id)) {
+                r->setRepository(entry.repository);
+            }
+        }
+    }
+}
+
+void PortageBackend::addInstalledPackages(const QHash<QString, InstalledPackageInfo> &installedInfo)
+{
     for (auto it = installedInfo.constBegin(); it != installedInfo.constEnd(); ++it) {
-        const QString atom = it.key();
-        const InstalledPackageInfo &info = it.value();
+        // Keys are lowercase, the store keeps the atom as spelled on disk
+        const PortagePackageStore::Id id = m_store.insert(it.value().atom);
+        if (id == PortagePackageStore::InvalidId) {
+            continue;
+        }
+        m_store.setFlag(id, PortagePackageStore::Installed);
+        m_store.setRepository(id, it.value().repository);
+        m_store.setSummary(id, it.value().description);
+        m_searchIndex.invalidate(id);
+        
+        // Installed packages are few and always shown, keep them materialized
+        if (PortageResource *r = materializedResource(id)) {
+            r->setInstalledInfo(it.value());
+        } else {
+            resourceForId(id);
+        }
+    }
+}
+
+void PortageBackend::recordLoadStamps()
+{
+    PortageRepositoryConfig &config = PortageRepositoryConfig::instance();
+    m_repoOrder = config.getAllRepositoryNames();
+    m_repoLocations.clear();
+    for (const QString &repo : std::as_const(m_repoOrder)) {
+        m_repoLocations.insert(repo, config.getRepositoryLocation(repo));
+    }
+    m_repoStamps = PortageCatalogCache::repositoryStamps();
+    m_vdbStamps = PortageInstalledReader::vdbStamps();
+}
+
+void PortageBackend::setRepositoryAtoms(const QHash<QString, QStringList> &repoAtoms)
+{
+    m_repoAtoms.clear();
+    for (auto it = repoAtoms.constBegin(); it != repoAtoms.constEnd(); ++it) {
+        QSet<PortagePackageStore::Id> &ids = m_repoAtoms[it.key()];
+        ids.reserve(it.value().size());
+        for (const QString &atom : it.value()) {
+            ids.insert(m_store.insert(atom));
+        }
+    }
+    
+    // Repository and path lookups of resources and USE flags go through this from now on
+    PortageRepositoryIndex::instance().setRepositoryAtoms(repoAtoms);
+}
+
+QString PortageBackend::providingRepository(PortagePackageStore::Id id) const
+{
+    for (const QString &repo : m_repoOrder) {
+        if (m_repoAtoms.value(repo).contains(id)) {
+            return repo;
+        }
+    }
+    return QString();
+}
+
+PortageResource *PortageBackend::resourceForAtom(const QString &atom)
+{
+    const PortagePackageStore::Id id = m_store.find(atom);
+    return id == PortagePackageStore::InvalidId ? nullptr : resourceForId(id);
+}
+
+PortageResource *PortageBackend::materializedResource(PortagePackageStore::Id id) const
+{
+    const auto it = m_materialized.constFind(id);
+    return it == m_materialized.constEnd() ? nullptr : it->resource;
+}
+
+PortageResource *PortageBackend::resourceForId(PortagePackageStore::Id id)
+{
+    if (!m_store.contains(id)) {
+        return nullptr;
+    }
+    
+    auto it = m_materialized.find(id);
+    if (it != m_materialized.end()) {
+        it->generation = m_generation;
+        it->compacted = false;
+        it->retired = false;
+        return it->resource;
+    }
+    
+    const QString atom = m_store.atom(id);
+    auto *r = new PortageResource(atom, m_store.name(id).toString(), m_store.summary(id).toString(), this);
+    const QString repo = m_store.repository(id);
+    if (!repo.isEmpty()) {
+        r->setRepository(repo);
+    }
+    if (m_store.hasFlag(id, PortagePackageStore::Installed)) {
+        r->setInstalledInfo(m_installedInfo.value(atom.toLower()));
+        const auto update = m_updates.constFind(id);
+        if (update != m_updates.constEnd()) {
+            r->setUpgradeVersion(update.value());
+            const auto use = m_updateUse.constFind(id);
+            if (use != m_updateUse.constEnd() && use->version == update.value()) {
+                r->setUpgradeUse(use->enabled, use->disabled);
+            }
+        }
+    }
+    
+    m_materialized.insert(id, MaterializedResource{r, m_generation, false});
+    return r;
+}
+
+void PortageBackend::releaseResource(PortagePackageStore::Id id)
+{
+    const auto it = m_materialized.constFind(id);
+    if (it == m_materialized.constEnd()) {
+        return;
+    }
+    PortageResource *r = it->resource;
+    const bool announced = it->retired;
+    m_materialized.erase(it);
+    if (!announced) {
+        Q_EMIT resourceRemoved(r);
+    }
+    r->deleteLater();
+}
+
+void PortageBackend::sweepIdleResources()
+{
+    ++m_generation;
+    
+    // Resources handed out by a stream that is still producing are in use
+    QSet<PortagePackageStore::Id> streamed;
+    m_streams.removeIf([](const QPointer<PortageResultsStream> &stream) {
+        return !stream || stream->isFinished();
+    });
+    for (const QPointer<PortageResultsStream> &stream : std::as_const(m_streams)) {
+        for (PortagePackageStore::Id id : stream->ids()) {
+            streamed.insert(id);
+        }
+    }
+    const auto inUse = [this, &streamed](PortagePackageStore::Id id, PortageResource *r) {
+        return m_store.hasFlag(id, PortagePackageStore::Installed) || streamed.contains(id)
+            || TransactionModel::global()->transactionFromResource(r);
+    };
+    
+    // Views, results models and open pages hold plain pointers, so a resource is released in
+    // two steps: resourceRemoved() first, so they let go of it, and deleteLater() one sweep
+    // later if nobody was handed it again in between
+    QList<PortagePackageStore::Id> released;
+    QList<PortagePackageStore::Id> retired;
+    int compacted = 0;
+    for (auto it = m_materialized.begin(); it != m_materialized.end(); ++it) {
+        if (it->retired) {
+            if (inUse(it.key(), it->resource)) {
+                // Picked up through a pointer kept past the announcement (installed, in a transaction)
+                it->retired = false;
+                it->generation = m_generation;
+            } else {
+                released << it.key();
+            }
+            continue;
+        }
+        if (it->generation + RETIRE_AFTER_SWEEPS <= m_generation && !inUse(it.key(), it->resource)) {
+            retired << it.key();
+            continue;
+        }
+        // Otherwise an idle resource only drops the metadata it reloads on the next access
+        if (!it->compacted && it->generation + COMPACT_AFTER_SWEEPS <= m_generation) {
+            it->resource->releaseMetadata();
+            it->compacted = true;
+            ++compacted;
+        }
+    }
+    
+    for (PortagePackageStore::Id id : std::as_const(released)) {
+        releaseResource(id);
+    }
+    // Announced outside the loop, receivers may ask for other resources (and so revive them)
+    for (PortagePackageStore::Id id : std::as_const(retired)) {
+        const auto it = m_materialized.find(id);
+        if (it != m_materialized.end() && it->generation + RETIRE_AFTER_SWEEPS <= m_generation) {
+            it->retired = true;
+            Q_EMIT resourceRemoved(it->resource);
+        }
+    }
+    
+    if (compacted > 0 || !retired.isEmpty() || !released.isEmpty()) {
+        qDebug() << "Portage: Compacted" << compacted << "and retired" << retired.size() << "idle resources, released"
+                 << released.size() << "-" << m_materialized.size() << "materialized";
+    }
+}
+
+void PortageBackend::logStoreUsage() const
+{
+    const qsizetype bytes = m_store.memoryUsage();
+    qDebug() << "Portage: Package store holds" << m_store.size() << "packages in" << bytes / 1024 << "KiB ("
+             << bytes / qMax(1, m_store.size()) << "bytes per package)," << m_materialized.size()
+             << "resources materialized, search index" << m_searchIndex.memoryUsage() / 1024 << "KiB";
+}
+
+void PortageBackend::removePackage(PortagePackageStore::Id id)
+{
+    m_updates.remove(id);
+    releaseResource(id);
+    m_store.remove(id);
+}
+
+QHash<QString, QStringList> PortageBackend::repositoryAtomLists() const
+{
+    QHash<QString, QStringList> repoAtoms;
+    for (auto it = m_repoAtoms.constBegin(); it != m_repoAtoms.constEnd(); ++it) {
+        QStringList &atoms = repoAtoms[it.key()];
+        atoms.reserve(it.value().size());
+        for (PortagePackageStore::Id id : it.value()) {
+            atoms << m_store.atom(id);
+        }
+    }
+    return repoAtoms;
+}
+
+void PortageBackend::saveSnapshot()
+{
+    // The stamps recorded before the data was read, not the current ones: a sync or
+    // merge that finished meanwhile must leave the snapshot stale
+    const QHash<QString, qint64> stamps = PortageCatalogCache::combineStamps(m_repoStamps, m_vdbStamps);
+    const QHash<QString, QStringList> repoAtoms = repositoryAtomLists();
+    const QHash<QString, InstalledPackageInfo> installedInfo = m_installedInfo;
+    QThreadPool::globalInstance()->start([stamps, repoAtoms, installedInfo]() {
+        PortageCatalogCache().save(stamps, repoAtoms, installedInfo);
+    });
+}
+
+int PortageBackend::applyRepositoryChanges(const QSet<PortagePackageStore::Id> &ids)
+{
+    int changes = 0;
+    for (PortagePackageStore::Id id : ids) {
+        if (!m_store.contains(id)) {
+            continue;
+        }
+        
+        const QString repo = providingRepository(id);
+        if (repo.isEmpty()) {
+            // Gone from every repository, installed packages stay visible
+            m_store.setFlag(id, PortagePackageStore::InRepository, false);
+            if (!m_store.hasFlag(id, PortagePackageStore::Installed)) {
+                removePackage(id);
+                ++changes;
+            }
+            continue;
+        }
         
-        // Look up by atom (category/package)
-        PortageResource *r = m_resources.value(atom.toLower(), nullptr);
+        m_store.setFlag(id, PortagePackageStore::InRepository);
+        PortageResource *r = materializedResource(id);
+        if (!m_store.hasFlag(id, PortagePackageStore::Installed) && m_store.repository(id) != repo) {
+            m_store.setRepository(id, repo);
+            if (r) {
+                r->setRepository(repo);
+            }
+            ++changes;
+        } else if (r) {
+            // Same provider, but a sync may have added or dropped versions; installed ones included
+            r->invalidateRepositoryData();
+        }
         if (r) {
-            r->setInstalledVersion(info.version);
-            r->setState(AbstractResource::Installed);
-            r->setRepository(info.repository);
-            r->setSlot(info.slot);
-            r->setInstalledUseFlags(info.useFlags);
-            r->setAvailableUseFlags(info.availableUseFlags);
+            Q_EMIT resourcesChanged(r, {"repository", "availableVersion", "longDescription"});
+        }
+    }
+    return changes;
+}
+
+int PortageBackend::applyInstalledChanges(const QHash<QString, InstalledPackageInfo> &installedInfo)
+{
+    int changes = 0;
+    
+    // Unmerged since the last load
+    for (auto it = m_installedInfo.constBegin(); it != m_installedInfo.constEnd(); ++it) {
+        if (installedInfo.contains(it.key())) {
+            continue;
+        }
+        const PortagePackageStore::Id id = m_store.find(it.key());
+        if (id == PortagePackageStore::InvalidId) {
+            continue;
+        }
+        
+        m_store.setFlag(id, PortagePackageStore::Installed, false);
+        m_store.setFlag(id, PortagePackageStore::Upgradeable, false);
+        m_updates.remove(id);
+        PortageResource *r = materializedResource(id);
+        if (r) {
+            r->clearInstalledInfo();
+        }
+        
+        const QString repo = providingRepository(id);
+        if (repo.isEmpty()) {
+            removePackage(id);
         } else {
-            // Create resource for installed package not present in repo scan
-            const QString pkg = atom.section(QLatin1Char('/'), 1);
-            PortageResource *nr = new PortageResource(atom, pkg, QString(), this);
-            nr->setInstalledVersion(info.version);
-            nr->setState(AbstractResource::Installed);
-            nr->setRepository(info.repository);
-            nr->setSlot(info.slot);
-            nr->setInstalledUseFlags(info.useFlags);
-            nr->setAvailableUseFlags(info.availableUseFlags);
-            m_resources.insert(atom.toLower(), nr);
+            m_store.setRepository(id, repo);
+            if (r) {
+                r->setRepository(repo);
+                Q_EMIT resourcesChanged(r, {"state", "installedVersion", "size"});
+            }
         }
+        ++changes;
     }
     
-    qDebug() << "Portage: Loaded" << m_resources.size() << "packages";
+    // Merged or rebuilt since the last load
+    for (auto it = installedInfo.constBegin(); it != installedInfo.constEnd(); ++it) {
+        const auto previous = m_installedInfo.constFind(it.key());
+        if (previous != m_installedInfo.constEnd() && previous.value() == it.value()) {
+            continue;
+        }
+        
+        const PortagePackageStore::Id id = m_store.insert(it.value().atom);
+        if (id == PortagePackageStore::InvalidId) {
+            continue;
+        }
+        m_store.setFlag(id, PortagePackageStore::Installed);
+        m_store.setFlag(id, PortagePackageStore::Upgradeable, false);
+        m_store.setRepository(id, it.value().repository);
+        m_store.setSummary(id, it.value().description);
+        m_searchIndex.invalidate(id);
+        
+        // Whatever the update was, it's stale now; the next check decides again
+        m_updates.remove(id);
+        PortageResource *r = resourceForId(id);
+        r->setInstalledInfo(it.value());
+        Q_EMIT resourcesChanged(r, {"state", "installedVersion", "size"});
+        ++changes;
+    }
+    
+    m_installedInfo = installedInfo;
+    return changes;
+}
+
+void PortageBackend::refreshInstalledCategories(const QStringList &categories)
+{
+    // Cached USE flag records go stale right away, even if the catalog has to wait
+    UseFlagInfoCache::instance().invalidateInstalled(categories);
+    
+    if (m_loading || m_reloading) {
+        // The running scan may already have read these categories, or not
+        for (const QString &category : categories) {
+            m_pendingVdbCategories.insert(category);
+        }
+        return;
+    }
+    
+    const QSet<QString> changed(categories.cbegin(), categories.cend());
+    QHash<QString, InstalledPackageInfo> installedInfo = m_installedInfo;
+    installedInfo.removeIf([&changed](const QHash<QString, InstalledPackageInfo>::iterator &it) {
+        return changed.contains(it.key().section(QLatin1Char('/'), 0, 0));
+    });
+    // Stamped before reading, like every other load
+    const QHash<QString, qint64> vdbStamps = PortageInstalledReader::vdbStamps();
+    installedInfo.insert(PortageInstalledReader::readCategories(categories));
+    
+    const int changes = applyInstalledChanges(installedInfo);
+    m_vdbStamps = vdbStamps;
+    
+    qDebug() << "Portage: Refreshed installed packages in" << categories << "-" << changes << "packages changed";
+    if (changes > 0) {
+        saveSnapshot();
+        Q_EMIT contentsChanged();
+        startUpdateCheck();
+    }
 }
 
 void PortageBackend::reloadPackages()
 {
+    if (m_loading || m_reloading) {
+        // Picked up again once the running load has joined
+        m_reloadPending = true;
+        return;
+    }
+    
     qDebug() << "Portage: Reloading packages after repository changes";
+    m_reloading = true;
+    
+    QElapsedTimer timer;
+    timer.start();
+    auto *watcher = new QFutureWatcher<ReloadScan>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, timer]() {
+        const ReloadScan scan = watcher->result();
+        watcher->deleteLater();
+        applyReload(scan);
+        qDebug() << "Portage: Package reload complete," << scan.changedRepos.size() << "repositories rescanned in"
+                 << timer.elapsed() << "ms";
+    });
+    // The configuration, the changed repositories and /var/db/pkg are read off the GUI thread
+    watcher->setFuture(QtConcurrent::run(&PortageBackend::scanForReload, m_repoStamps, m_vdbStamps));
+}
+
+PortageBackend::ReloadScan PortageBackend::scanForReload(const QHash<QString, qint64> &repoStamps,
+                                                         const QHash<QString, qint64> &vdbStamps)
+{
+    ReloadScan scan;
+    
+    PortageRepositoryConfig &config = PortageRepositoryConfig::instance();
+    config.reload();
+    
+    scan.repoOrder = config.getAllRepositoryNames();
+    scan.repoStamps = PortageCatalogCache::repositoryStamps();
+    
+    // Added repositories and ones whose tree changed are rescanned, nothing else is
+    for (const QString &repo : std::as_const(scan.repoOrder)) {
+        const QString location = config.getRepositoryLocation(repo);
+        scan.repoLocations.insert(repo, location);
+        const QString key = PortageCatalogCache::repositoryKey(repo, location);
+        if (!repoStamps.contains(key) || repoStamps.value(key) != scan.repoStamps.value(key)) {
+            scan.changedRepos << repo;
+        }
+    }
+    
+    if (!scan.changedRepos.isEmpty()) {
+        PortageRepositoryReader reader(nullptr);
+        reader.loadRepository(scan.changedRepos);
+        scan.scannedAtoms = reader.repositoryAtoms();
+    }
     
-    // Clear all existing resources
-    qDeleteAll(m_resources);
-    m_resources.clear();
+    // Installed state, the vdb snapshot makes this cheap when nothing was merged
+    scan.vdbStamps = PortageInstalledReader::vdbStamps();
+    if (scan.vdbStamps != vdbStamps) {
+        scan.vdbChanged = true;
+        PortageInstalledReader instReader(nullptr);
+        instReader.loadInstalledPackages();
+        scan.installedInfo = instReader.installedPackagesInfo();
+    }
+    return scan;
+}
+
+void PortageBackend::invalidateRepositoryCaches(const QString &location)
+{
+    if (location.isEmpty()) {
+        return;
+    }
+    PortageMetadataCache::instance().invalidate(location);
+    PortageMetadataXml::instance().invalidate(location);
+    PortageVersionIndex::instance().invalidate(location);
+    UseFlagInfoCache::instance().invalidateRepository(location);
+}
+
+void PortageBackend::applyReload(const ReloadScan &scan)
+{
+    m_reloading = false;
     
-    // Reload from disk
-    loadPackages();
+    QSet<PortagePackageStore::Id> affected;
+    bool reposRemoved = false;
+    const QStringList knownRepos = m_repoAtoms.keys();
+    for (const QString &repo : knownRepos) {
+        if (!scan.repoOrder.contains(repo)) {
+            affected += m_repoAtoms.take(repo);
+            invalidateRepositoryCaches(m_repoLocations.value(repo));
+            reposRemoved = true;
+        }
+    }
     
-    // Notify Discover that ALL data has changed (entire package catalog)
-    Q_EMIT allDataChanged(QVector<QByteArray>());
+    for (const QString &repo : scan.changedRepos) {
+        QSet<PortagePackageStore::Id> ids;
+        const QStringList atoms = scan.scannedAtoms.value(repo);
+        for (const QString &atom : atoms) {
+            ids.insert(m_store.insert(atom));
+        }
+        affected += m_repoAtoms.value(repo);
+        affected += ids;
+        m_repoAtoms.insert(repo, ids);
+        
+        // A relocated repository leaves entries for its old location behind
+        const QString oldLocation = m_repoLocations.value(repo);
+        if (oldLocation != scan.repoLocations.value(repo)) {
+            invalidateRepositoryCaches(oldLocation);
+        }
+        invalidateRepositoryCaches(scan.repoLocations.value(repo));
+    }
     
-    qDebug() << "Portage: Package reload complete," << m_resources.size() << "packages loaded";
+    // A new priority order can change the provider of any atom, but needs no rescan
+    QStringList oldOrder = m_repoOrder;
+    QStringList newOrder = scan.repoOrder;
+    oldOrder.removeIf([&scan](const QString &repo) { return !scan.repoOrder.contains(repo); });
+    newOrder.removeIf([this](const QString &repo) { return !m_repoOrder.contains(repo); });
+    m_repoOrder = scan.repoOrder;
+    m_repoLocations = scan.repoLocations;
+    m_repoStamps = scan.repoStamps;
+    if (oldOrder != newOrder) {
+        for (const QSet<PortagePackageStore::Id> &ids : std::as_const(m_repoAtoms)) {
+            affected += ids;
+        }
+    }
+    
+    if (!scan.changedRepos.isEmpty() || reposRemoved || oldOrder != newOrder) {
+        PortageRepositoryIndex::instance().setRepositoryAtoms(repositoryAtomLists());
+    }
+    
+    int changes = applyRepositoryChanges(affected);
+    
+    if (scan.vdbChanged) {
+        // Cached USE flag records of whatever was merged, rebuilt or unmerged meanwhile
+        QSet<QString> categories;
+        for (auto it = scan.installedInfo.constBegin(); it != scan.installedInfo.constEnd(); ++it) {
+            if (m_installedInfo.value(it.key()) != it.value()) {
+                categories.insert(it.value().atom.section(QLatin1Char('/'), 0, 0));
+            }
+        }
+        for (auto it = m_installedInfo.constBegin(); it != m_installedInfo.constEnd(); ++it) {
+            if (!scan.installedInfo.contains(it.key())) {
+                categories.insert(it.value().atom.section(QLatin1Char('/'), 0, 0));
+            }
+        }
+        if (!categories.isEmpty()) {
+            UseFlagInfoCache::instance().invalidateInstalled(categories.values());
+        }
+        
+        m_vdbStamps = scan.vdbStamps;
+        changes += applyInstalledChanges(scan.installedInfo);
+    }
+    
+    qDebug() << "Portage: Reload checked" << affected.size() << "atoms," << changes << "packages changed";
+    if (changes > 0) {
+        saveSnapshot();
+        Q_EMIT contentsChanged();
+    }
+    
+    if (!m_pendingVdbCategories.isEmpty()) {
+        refreshInstalledCategories(m_pendingVdbCategories.values());
+        m_pendingVdbCategories.clear();
+    }
+    
+    if (m_reloadPending) {
+        m_reloadPending = false;
+        reloadPackages();
+        return;
+    }
+    
+    // Also picks up checks and index updates that were requested during the reload
+    if (changes > 0 || m_updateCheckPending) {
+        startUpdateCheck();
+    }
+    if (!scan.changedRepos.isEmpty() || reposRemoved || m_textIndexPending) {
+        updateTextIndex();
+    }
 }
 
 #include "PortageBackend.moc"
@@ -6,12 +6,25 @@
 #pragma once
 
 #include <QHash>
+#include <QPointer>
+#include <QSet>
 #include <resources/AbstractResourcesBackend.h>
 
+#include "PortagePackageStore.h"
+#include "PortageSearchIndex.h"
+#include "../cache/PortageTextIndex.h"
+#include "../installed/PortageInstalledReader.h"
+#include "../repository/PortageRepositoryReader.h"
+#include "../utils/UseFlagSet.h"
+
+class QFutureWatcherBase;
+class QTimer;
 class PortageResource;
+class PortageResultsStream;
 class StandardBackendUpdater;
 class PortageQmlInjector;
 class PortageSourcesBackend;
+class PortageVdbWatcher;
 
 class PortageBackend : public AbstractResourcesBackend
 {
@@ -30,7 +43,7 @@ public:
     int updatesCount() const override;
     AbstractBackendUpdater *backendUpdater() const override;
     void checkForUpdates() override;
-    int fetchingUpdatesProgress() const override { return 100; }
+    int fetchingUpdatesProgress() const override { return m_loadProgress; }
 
     Transaction *installApplication(AbstractResource *app) override;
     Transaction *installApplication(AbstractResource *app, const AddonList &addons) override;
@@ -39,22 +52,126 @@ public:
     AbstractReviewsBackend *reviewsBackend() const override { return nullptr; }
     PortageSourcesBackend *sourcesBackend() const { return m_sourcesBackend; }
 
-    QHash<QString, PortageResource *> resources() const { return m_resources; }
+    // PortageResource for an atom, created on first use (nullptr for unknown atoms)
+    PortageResource *resourceForAtom(const QString &atom);
+    PortageResource *resourceForId(PortagePackageStore::Id id);
     
     // Show version selection and USE flags dialogs, returns false if cancelled
     bool showInstallDialogs(PortageResource *portageRes);
     
-    // Reload packages from repositories after repository changes
+    // Reload packages from repositories after repository changes, the rescan runs in the background
     void reloadPackages();
+    
+    // Re-read installed packages of the given /var/db/pkg categories and update their resources
+    void refreshInstalledCategories(const QStringList &categories);
 
 private:
-    void populateTestPackages();
     void setupQmlInjector();
-    void loadPackages(); // Internal package loading logic
+    
+    // Background loading: /var/db/pkg and repositories are scanned at the
+    // same time, installed packages are published first
+    void startLoading();
+    void onInstalledLoaded(const QHash<QString, InstalledPackageInfo> &installedInfo);
+    void onRepositoryPackagesFound(const QList<RepositoryPackageEntry> &entries);
+    void onLoadPartFinished();
+    void updateLoadProgress();
+    void scheduleContentsChanged();
+    
+    void addRepositoryPackages(const QList<RepositoryPackageEntry> &entries);
+    void addInstalledPackages(const QHash<QString, InstalledPackageInfo> &installedInfo);
+    
+    // Incremental reload: only atoms of changed repositories and changed vdb entries are touched
+    struct ReloadScan {
+        QStringList repoOrder;
+        QHash<QString, QString> repoLocations;
+        QHash<QString, qint64> repoStamps;
+        QStringList changedRepos;                   // added, relocated or synced since the last load
+        QHash<QString, QStringList> scannedAtoms;   // changedRepos -> atoms
+        QHash<QString, qint64> vdbStamps;
+        bool vdbChanged = false;
+        QHash<QString, InstalledPackageInfo> installedInfo; // only read when vdbChanged
+    };
+    static ReloadScan scanForReload(const QHash<QString, qint64> &repoStamps, const QHash<QString, qint64> &vdbStamps);
+    void applyReload(const ReloadScan &scan);
+    static void invalidateRepositoryCaches(const QString &location);
+    void recordLoadStamps();
+    void setRepositoryAtoms(const QHash<QString, QStringList> &repoAtoms);
+    QString providingRepository(PortagePackageStore::Id id) const;
+    int applyRepositoryChanges(const QSet<PortagePackageStore::Id> &ids);
+    int applyInstalledChanges(const QHash<QString, InstalledPackageInfo> &installedInfo);
+    void removePackage(PortagePackageStore::Id id);
+    QHash<QString, QStringList> repositoryAtomLists() const;
+    void saveSnapshot();
+    
+    // Native update check, see PortageUpdateChecker
+    void startUpdateCheck();
+    void applyUpdates(const QHash<QString, QString> &updates);
+    void predictUpdateUse();
+    
+    // Description index, synced with the repositories in the background
+    void updateTextIndex();
+    
+    // PortageResource objects only exist for packages somebody asked for
+    PortageResource *materializedResource(PortagePackageStore::Id id) const;
+    void releaseResource(PortagePackageStore::Id id);
+    void sweepIdleResources();
+    void logStoreUsage() const;
 
-    QHash<QString, PortageResource *> m_resources;
+    struct MaterializedResource {
+        PortageResource *resource = nullptr;
+        quint32 generation = 0; // sweep generation it was last handed out in
+        bool compacted = false; // lazily loaded metadata dropped since then
+        bool retired = false;   // resourceRemoved() announced, deleted by the next sweep
+    };
+    
+    struct UpgradeUse {
+        QString version; // the upgrade version it was predicted for
+        UseFlagSet enabled;
+        UseFlagSet disabled;
+    };
+    
+    PortagePackageStore m_store;
+    PortageSearchIndex m_searchIndex;
+    QPointer<PortageResultsStream> m_textStream;          // latest text search, still producing
+    QList<QPointer<PortageResultsStream>> m_streams;      // every stream handed out, pruned by the sweep
+    mutable QList<std::shared_ptr<Category>> m_categoryTree; // cached category() result
+    mutable quint32 m_categoryTreeRevision;
+    QHash<PortagePackageStore::Id, MaterializedResource> m_materialized;
     StandardBackendUpdater *m_updater;
     PortageQmlInjector *m_qmlInjector;
     PortageSourcesBackend *m_sourcesBackend;
     bool m_initialized;
+    
+    PortageRepositoryReader *m_repoReader;
+    QHash<QString, InstalledPackageInfo> m_installedInfo; // atom (lowercase) -> last vdb state
+    QHash<QString, QSet<PortagePackageStore::Id>> m_repoAtoms; // repository -> atoms, shadowed ones included
+    QStringList m_repoOrder;                              // configuration order at the last load
+    QHash<QString, QString> m_repoLocations;              // repository -> location at the last load
+    QHash<QString, qint64> m_repoStamps;                  // PortageCatalogCache::repositoryStamps()
+    QHash<QString, qint64> m_vdbStamps;                   // PortageInstalledReader::vdbStamps()
+    PortageVdbWatcher *m_vdbWatcher;
+    QSet<QString> m_pendingVdbCategories;                 // changed while a load or reload was running
+    QTimer *m_sweepTimer;
+    QHash<PortagePackageStore::Id, QString> m_updates;   // upgradeable installed package -> newer version
+    QHash<PortagePackageStore::Id, UpgradeUse> m_updateUse; // effective USE predicted for m_updates
+    QPointer<QFutureWatcherBase> m_updateUseWatcher;
+    bool m_checkingUpdates;
+    bool m_updateCheckPending;                            // requested while a load or check was running
+    PortageTextIndex m_textIndex;
+    bool m_updatingTextIndex;
+    bool m_textIndexPending;                              // requested while a load or update was running
+    quint32 m_generation;
+    QList<RepositoryPackageEntry> m_pendingRepoEntries;          // held back until installed packages are in
+    QTimer *m_contentsTimer;
+    bool m_loading;
+    bool m_installedLoaded;
+    bool m_reloading;      // reloadPackages() scan running
+    bool m_reloadPending;
+    int m_pendingLoadParts;
+    int m_repoProgress;    // 0-100 of the repository scan
+    int m_loadProgress;
+    
+    static constexpr int SWEEP_INTERVAL_MS = 5 * 60 * 1000;
+    static constexpr quint32 COMPACT_AFTER_SWEEPS = 3;
+    static constexpr quint32 RETIRE_AFTER_SWEEPS = 6;
 };
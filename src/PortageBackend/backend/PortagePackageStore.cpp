@@ -0,0 +1,240 @@
+/*
+ *   SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include "PortagePackageStore.h"
+
+#include <QDebug>
+
+PortagePackageStore::PortagePackageStore()
+    : m_repoNames({QString()})
+{
+    m_repoIdByName.insert(QString(), 0);
+    rehash(1024);
+}
+
+size_t PortagePackageStore::hashAppend(size_t hash, QStringView text)
+{
+    // FNV-1a over case-folded UTF-16 units
+    for (QChar c : text) {
+        hash ^= c.toLower().unicode();
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+size_t PortagePackageStore::atomHash(QStringView atom)
+{
+    return hashAppend(14695981039346656037ULL, atom);
+}
+
+size_t PortagePackageStore::hashOf(Id id) const
+{
+    size_t hash = hashAppend(14695981039346656037ULL, m_categoryNames.at(m_categoryIds.at(id)));
+    hash = hashAppend(hash, u"/");
+    return hashAppend(hash, name(id));
+}
+
+bool PortagePackageStore::matches(Id id, QStringView atom) const
+{
+    const QString &category = m_categoryNames.at(m_categoryIds.at(id));
+    const QStringView pkgName = name(id);
+    return atom.size() == category.size() + 1 + pkgName.size()
+        && atom.at(category.size()) == QLatin1Char('/')
+        && atom.first(category.size()).compare(category, Qt::CaseInsensitive) == 0
+        && atom.sliced(category.size() + 1).compare(pkgName, Qt::CaseInsensitive) == 0;
+}
+
+void PortagePackageStore::rehash(qsizetype slotCount)
+{
+    m_slots.fill(InvalidId, slotCount);
+    const size_t mask = size_t(slotCount - 1);
+    for (Id id = 0; id < idCount(); ++id) {
+        size_t slot = hashOf(id) & mask;
+        while (m_slots.at(slot) != InvalidId) {
+            slot = (slot + 1) & mask;
+        }
+        m_slots[slot] = id;
+    }
+}
+
+PortagePackageStore::Id PortagePackageStore::find(QStringView atom) const
+{
+    const size_t mask = size_t(m_slots.size() - 1);
+    for (size_t slot = atomHash(atom) & mask; m_slots.at(slot) != InvalidId; slot = (slot + 1) & mask) {
+        const Id id = m_slots.at(slot);
+        if (!(m_flags.at(id) & Removed) && matches(id, atom)) {
+            return id;
+        }
+    }
+    return InvalidId;
+}
+
+PortagePackageStore::Id PortagePackageStore::insert(QStringView atom)
+{
+    const qsizetype slash = atom.indexOf(QLatin1Char('/'));
+    if (slash <= 0 || slash == atom.size() - 1) {
+        return InvalidId;
+    }
+
+    const size_t mask = size_t(m_slots.size() - 1);
+    size_t slot = atomHash(atom) & mask;
+    for (; m_slots.at(slot) != InvalidId; slot = (slot + 1) & mask) {
+        const Id id = m_slots.at(slot);
+        if (matches(id, atom)) {
+            if (m_flags.at(id) & Removed) {
+                // Came back (overlay re-added, package re-merged): reuse the row
+                m_flags[id] = 0;
+                m_repoIds[id] = 0;
+                addToCategory(m_categoryIds.at(id));
+                ++m_size;
+            }
+            return id;
+        }
+    }
+
+    const Id id = idCount();
+    const quint16 categoryId = internCategory(atom.first(slash));
+    const QStringView pkgName = atom.sliced(slash + 1);
+
+    m_categoryIds.append(categoryId);
+    m_repoIds.append(0);
+    m_flags.append(0);
+    m_nameOffsets.append(quint32(m_names.size()));
+    m_nameLengths.append(quint16(pkgName.size()));
+    m_names.append(pkgName);
+    m_summaryOffsets.append(0);
+    m_summaryLengths.append(0);
+    m_categoryMembers[categoryId].append(id);
+    addToCategory(categoryId);
+    ++m_size;
+
+    // Keep the index at most half full
+    if (qsizetype(idCount()) * 2 > m_slots.size()) {
+        rehash(m_slots.size() * 2);
+    } else {
+        m_slots[slot] = id;
+    }
+    return id;
+}
+
+void PortagePackageStore::remove(Id id)
+{
+    if (!contains(id)) {
+        return;
+    }
+    // The row stays in the index as a tombstone, insert() revives it
+    m_flags[id] = Removed;
+    if (--m_categorySizes[m_categoryIds.at(id)] == 0) {
+        ++m_categoriesRevision;
+    }
+    --m_size;
+}
+
+void PortagePackageStore::addToCategory(quint16 categoryId)
+{
+    if (m_categorySizes[categoryId]++ == 0) {
+        ++m_categoriesRevision;
+    }
+}
+
+QString PortagePackageStore::atom(Id id) const
+{
+    return m_categoryNames.at(m_categoryIds.at(id)) + QLatin1Char('/') + name(id);
+}
+
+QStringView PortagePackageStore::name(Id id) const
+{
+    return QStringView(m_names).sliced(m_nameOffsets.at(id), m_nameLengths.at(id));
+}
+
+QStringList PortagePackageStore::categories() const
+{
+    QStringList result;
+    for (qsizetype i = 0; i < m_categoryNames.size(); ++i) {
+        if (m_categorySizes.at(i) > 0) {
+            result << m_categoryNames.at(i);
+        }
+    }
+    return result;
+}
+
+void PortagePackageStore::setRepository(Id id, const QString &repository)
+{
+    m_repoIds[id] = internRepository(repository);
+}
+
+QStringView PortagePackageStore::summary(Id id) const
+{
+    return QStringView(m_summaries).sliced(m_summaryOffsets.at(id), m_summaryLengths.at(id));
+}
+
+void PortagePackageStore::setSummary(Id id, QStringView summary)
+{
+    if (summary == this->summary(id)) {
+        return;
+    }
+    // Replaced summaries are not reclaimed, they only change on merges
+    const QStringView text = summary.first(qMin<qsizetype>(summary.size(), std::numeric_limits<quint16>::max()));
+    m_summaryOffsets[id] = quint32(m_summaries.size());
+    m_summaryLengths[id] = quint16(text.size());
+    m_summaries.append(text);
+}
+
+void PortagePackageStore::setFlag(Id id, Flag flag, bool on)
+{
+    if (on) {
+        m_flags[id] |= flag;
+    } else {
+        m_flags[id] &= ~flag;
+    }
+}
+
+quint16 PortagePackageStore::internCategory(QStringView category)
+{
+    const QString name = category.toString();
+    const auto it = m_categoryIdByName.constFind(name);
+    if (it != m_categoryIdByName.constEnd()) {
+        return it.value();
+    }
+    const quint16 categoryId = quint16(m_categoryNames.size());
+    m_categoryNames << name;
+    m_categoryIdByName.insert(name, categoryId);
+    m_categorySizes.append(0);
+    m_categoryMembers.append(QList<Id>());
+    return categoryId;
+}
+
+quint16 PortagePackageStore::internRepository(const QString &repository)
+{
+    const auto it = m_repoIdByName.constFind(repository);
+    if (it != m_repoIdByName.constEnd()) {
+        return it.value();
+    }
+    const quint16 repoId = quint16(m_repoNames.size());
+    m_repoNames << repository;
+    m_repoIdByName.insert(repository, repoId);
+    return repoId;
+}
+
+qsizetype PortagePackageStore::memoryUsage() const
+{
+    qsizetype bytes = 0;
+    bytes += m_categoryIds.capacity() * qsizetype(sizeof(quint16));
+    bytes += m_repoIds.capacity() * qsizetype(sizeof(quint16));
+    bytes += m_flags.capacity() * qsizetype(sizeof(quint8));
+    bytes += m_nameOffsets.capacity() * qsizetype(sizeof(quint32));
+    bytes += m_nameLengths.capacity() * qsizetype(sizeof(quint16));
+    bytes += m_summaryOffsets.capacity() * qsizetype(sizeof(quint32));
+    bytes += m_summaryLengths.capacity() * qsizetype(sizeof(quint16));
+    bytes += (m_names.capacity() + m_summaries.capacity()) * qsizetype(sizeof(QChar));
+    bytes += m_slots.capacity() * qsizetype(sizeof(Id));
+    for (const QString &category : m_categoryNames) {
+        bytes += category.capacity() * qsizetype(sizeof(QChar));
+    }
+    for (const QList<Id> &members : m_categoryMembers) {
+        bytes += members.capacity() * qsizetype(sizeof(Id));
+    }
+    return bytes;
+}
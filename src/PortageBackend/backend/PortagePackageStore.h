@@ -0,0 +1,111 @@
+/*
+ *   SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include <limits>
+
+/**
+ * @brief Columnar store of every known package
+ *
+ * One row per atom, addressed by a dense id. Categories and repositories
+ * are interned, package names and summaries live in shared string arenas
+ * and state is packed into a flag byte, so a package costs a few dozen
+ * bytes instead of a PortageResource. Atom lookups go through an
+ * open-addressing index and are case-insensitive. Removed rows keep their
+ * id (and are revived if the atom comes back), so ids held elsewhere never
+ * point at a different package.
+ */
+class PortagePackageStore
+{
+public:
+    using Id = quint32;
+    static constexpr Id InvalidId = std::numeric_limits<Id>::max();
+
+    enum Flag : quint8 {
+        InRepository = 0x01,
+        Installed = 0x02,
+        Upgradeable = 0x04,
+        Removed = 0x80,
+    };
+
+    PortagePackageStore();
+
+    Id find(QStringView atom) const;
+    Id insert(QStringView atom); // returns the existing id if the atom is known
+    void remove(Id id);
+
+    bool contains(Id id) const { return id < Id(m_flags.size()) && !(m_flags.at(id) & Removed); }
+    Id idCount() const { return Id(m_flags.size()); } // every id is below this, removed ones included
+    int size() const { return m_size; }
+
+    QString atom(Id id) const;
+    QStringView name(Id id) const;
+    quint16 categoryId(Id id) const { return m_categoryIds.at(id); }
+    QString category(Id id) const { return m_categoryNames.at(m_categoryIds.at(id)); }
+    QString categoryName(quint16 categoryId) const { return m_categoryNames.value(categoryId); }
+    quint16 findCategory(const QString &category) const { return m_categoryIdByName.value(category, NoCategory); }
+    QStringList categories() const; // categories that have at least one package
+    
+    // Every id ever inserted in a category, ascending; removed rows are included, check contains()
+    const QList<Id> &categoryMembers(quint16 categoryId) const { return m_categoryMembers.at(categoryId); }
+    
+    // Bumped whenever a category gains its first package or loses its last one
+    quint32 categoriesRevision() const { return m_categoriesRevision; }
+
+    QString repository(Id id) const { return m_repoNames.at(m_repoIds.at(id)); }
+    void setRepository(Id id, const QString &repository);
+
+    QStringView summary(Id id) const;
+    void setSummary(Id id, QStringView summary);
+
+    quint8 flags(Id id) const { return m_flags.at(id); }
+    bool hasFlag(Id id, Flag flag) const { return m_flags.at(id) & flag; }
+    void setFlag(Id id, Flag flag, bool on = true);
+
+    // Approximate heap usage of all columns, arenas and the index
+    qsizetype memoryUsage() const;
+
+    static constexpr quint16 NoCategory = std::numeric_limits<quint16>::max();
+
+private:
+    bool matches(Id id, QStringView atom) const;
+    size_t hashOf(Id id) const;
+    void rehash(qsizetype slotCount);
+    quint16 internCategory(QStringView category);
+    void addToCategory(quint16 categoryId);
+    quint16 internRepository(const QString &repository);
+
+    static size_t hashAppend(size_t hash, QStringView text);
+    static size_t atomHash(QStringView atom);
+
+    // Columns, indexed by id
+    QList<quint16> m_categoryIds;
+    QList<quint16> m_repoIds;
+    QList<quint8> m_flags;
+    QList<quint32> m_nameOffsets;
+    QList<quint16> m_nameLengths;
+    QList<quint32> m_summaryOffsets;
+    QList<quint16> m_summaryLengths;
+
+    // Shared storage
+    QString m_names;
+    QString m_summaries;
+    QStringList m_categoryNames;
+    QHash<QString, quint16> m_categoryIdByName;
+    QList<quint32> m_categorySizes;
+    QList<QList<Id>> m_categoryMembers;
+    quint32 m_categoriesRevision = 0;
+    QStringList m_repoNames; // index 0 is "no repository"
+    QHash<QString, quint16> m_repoIdByName;
+
+    QList<Id> m_slots; // open addressing, InvalidId marks a free slot
+    int m_size = 0;
+};
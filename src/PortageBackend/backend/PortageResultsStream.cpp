@@ -0,0 +1,87 @@
+/*
+ *   SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include "PortageResultsStream.h"
+#include "PortageBackend.h"
+#include "../resources/PortageResource.h"
+#include "../repository/PortageMetadataXml.h"
+#include "../repository/PortageRepositoryConfig.h"
+
+#include <QDebug>
+#include <QTimer>
+
+PortageResultsStream::PortageResultsStream(PortageBackend *backend,
+                                           const QList<PortagePackageStore::Id> &ids,
+                                           const QList<uint> &scores,
+                                           Mode mode)
+    : ResultsStream(QStringLiteral("Portage-search"))
+    , m_backend(backend)
+    , m_ids(ids)
+    , m_scores(scores)
+    , m_mode(mode)
+{
+    connect(this, &ResultsStream::fetchMore, this, &PortageResultsStream::producePage);
+    
+    // The caller connects to resourcesFound() after search() returned
+    QTimer::singleShot(0, this, &PortageResultsStream::producePage);
+}
+
+void PortageResultsStream::cancel()
+{
+    if (m_finished) {
+        return;
+    }
+    qDebug() << "Portage: Search stream cancelled with" << m_ids.size() - m_next << "results left";
+    m_finished = true;
+    finish();
+}
+
+void PortageResultsStream::producePage()
+{
+    if (m_finished) {
+        return;
+    }
+    
+    do {
+        QVector<StreamResult> page;
+        page.reserve(qMin(PAGE_SIZE, m_ids.size() - m_next));
+        
+        // Packages removed since the search ran don't count towards the page
+        while (m_backend && m_next < m_ids.size() && page.size() < PAGE_SIZE) {
+            if (PortageResource *resource = m_backend->resourceForId(m_ids.at(m_next))) {
+                page << StreamResult(resource, m_scores.value(m_next));
+            }
+            ++m_next;
+        }
+        
+        if (!page.isEmpty()) {
+            Q_EMIT resourcesFound(page);
+            if (m_mode == Mode::OnDemand) {
+                prefetchMetadata(page);
+            }
+        }
+    } while (m_mode == Mode::All && m_backend && m_next < m_ids.size());
+    
+    if (!m_backend || m_next >= m_ids.size()) {
+        m_finished = true;
+        finish();
+    }
+}
+
+void PortageResultsStream::prefetchMetadata(const QVector<StreamResult> &page)
+{
+    // Whatever is shown is likely to be opened next
+    PortageRepositoryConfig &config = PortageRepositoryConfig::instance();
+    QStringList pkgDirs;
+    pkgDirs.reserve(page.size());
+    for (const StreamResult &result : page) {
+        const auto *resource = static_cast<PortageResource *>(result.resource);
+        const QString location = config.getRepositoryLocation(resource->repository());
+        if (!location.isEmpty() && !resource->repository().isEmpty()) {
+            pkgDirs << location + QLatin1Char('/') + resource->atom();
+        }
+    }
+    PortageMetadataXml::instance().prefetch(pkgDirs);
+}
@@ -0,0 +1,62 @@
+/*
+ *   SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#pragma once
+
+#include <QList>
+#include <QPointer>
+#include <resources/AbstractResourcesBackend.h>
+
+#include "PortagePackageStore.h"
+
+class PortageBackend;
+
+/**
+ * @brief Search results produced a page at a time
+ *
+ * Holds only the matched store ids. The first page is sent as soon as the
+ * consumer had a chance to connect, every further one in response to
+ * fetchMore(), which Discover emits when the list is scrolled to its end.
+ * PortageResource objects are created for the page being sent only.
+ * Nothing is scheduled between pages, so deleting the stream (a superseded
+ * search, a closed page) simply stops production.
+ *
+ * Consumers that never ask for more, like the updater, get every page
+ * right away. metadata.xml of on-demand pages is prefetched in the
+ * background.
+ */
+class PortageResultsStream : public ResultsStream
+{
+    Q_OBJECT
+public:
+    enum class Mode {
+        OnDemand,
+        All,
+    };
+
+    PortageResultsStream(PortageBackend *backend,
+                         const QList<PortagePackageStore::Id> &ids,
+                         const QList<uint> &scores,
+                         Mode mode = Mode::OnDemand);
+
+    // Stop producing, the stream finishes without sending anything else
+    void cancel();
+
+    const QList<PortagePackageStore::Id> &ids() const { return m_ids; }
+    bool isFinished() const { return m_finished; }
+
+private:
+    void producePage();
+    void prefetchMetadata(const QVector<StreamResult> &page);
+
+    QPointer<PortageBackend> m_backend;
+    QList<PortagePackageStore::Id> m_ids;
+    QList<uint> m_scores; // sort score per id, empty if unranked
+    qsizetype m_next = 0;
+    Mode m_mode;
+    bool m_finished = false;
+
+    static constexpr qsizetype PAGE_SIZE = 100;
+};
@@ -0,0 +1,280 @@
+/*
+ *   SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include "PortageSearchIndex.h"
+#include "../utils/FuzzyMatcher.h"
+
+#include <algorithm>
+
+PortageSearchIndex::PortageSearchIndex(const PortagePackageStore &store)
+    : m_store(store)
+{
+}
+
+PortageSearchIndex::Trigram PortageSearchIndex::trigramAt(QStringView text, qsizetype pos)
+{
+    return (Trigram(text.at(pos).toCaseFolded().unicode()) << 32)
+        | (Trigram(text.at(pos + 1).toCaseFolded().unicode()) << 16)
+        | Trigram(text.at(pos + 2).toCaseFolded().unicode());
+}
+
+void PortageSearchIndex::indexText(PortagePackageStore::Id id, QStringView text, bool sortedInsert)
+{
+    for (qsizetype pos = 0; pos + 3 <= text.size(); ++pos) {
+        QList<PortagePackageStore::Id> &postings = m_postings[trigramAt(text, pos)];
+        if (!sortedInsert) {
+            // Ids are indexed in ascending order, a repeated trigram is already last
+            if (postings.isEmpty() || postings.constLast() != id) {
+                postings.append(id);
+            }
+            continue;
+        }
+        const auto it = std::lower_bound(postings.begin(), postings.end(), id);
+        if (it == postings.end() || *it != id) {
+            postings.insert(it, id);
+        }
+    }
+}
+
+void PortageSearchIndex::invalidate(PortagePackageStore::Id id)
+{
+    if (id < m_indexedIds) {
+        m_dirty.insert(id);
+    }
+}
+
+void PortageSearchIndex::update()
+{
+    const PortagePackageStore::Id indexed = m_indexedIds;
+    const PortagePackageStore::Id count = m_store.idCount();
+    if (indexed == count && m_dirty.isEmpty() && m_storeSize == m_store.size()) {
+        return;
+    }
+    m_storeSize = m_store.size();
+    
+    // Removed rows are indexed too, insert() may bring them back under the same id
+    for (PortagePackageStore::Id id = indexed; id < count; ++id) {
+        indexText(id, m_store.atom(id), false);
+        indexText(id, m_store.summary(id), false);
+    }
+    m_indexedIds = count;
+    
+    // Postings of the old summary stay, verification drops them
+    for (PortagePackageStore::Id id : std::as_const(m_dirty)) {
+        indexText(id, m_store.summary(id), true);
+    }
+    m_dirty.clear();
+    
+    // Packages the last result was computed without
+    m_lastQuery.clear();
+    m_lastResult.clear();
+}
+
+QList<PortagePackageStore::Id> PortageSearchIndex::candidates(QStringView query) const
+{
+    QList<const QList<PortagePackageStore::Id> *> lists;
+    for (qsizetype pos = 0; pos + 3 <= query.size(); ++pos) {
+        const auto it = m_postings.constFind(trigramAt(query, pos));
+        if (it == m_postings.constEnd()) {
+            return {};
+        }
+        lists << &it.value();
+    }
+    
+    std::sort(lists.begin(), lists.end(), [](const auto *a, const auto *b) {
+        return a->size() < b->size();
+    });
+    
+    // Intersect, shortest list first so the working set only shrinks
+    QList<PortagePackageStore::Id> result = *lists.constFirst();
+    for (qsizetype i = 1; i < lists.size() && !result.isEmpty(); ++i) {
+        const QList<PortagePackageStore::Id> &other = *lists.at(i);
+        QList<PortagePackageStore::Id> intersection;
+        intersection.reserve(result.size());
+        std::set_intersection(result.cbegin(), result.cend(), other.cbegin(), other.cend(),
+                              std::back_inserter(intersection));
+        result = std::move(intersection);
+    }
+    return result;
+}
+
+PortageSearchIndex::Rank PortageSearchIndex::rank(PortagePackageStore::Id id, QStringView query) const
+{
+    if (!m_store.contains(id)) {
+        return NoMatch;
+    }
+    
+    const QStringView name = m_store.name(id);
+    const QString category = m_store.categoryName(m_store.categoryId(id));
+    
+    const qsizetype slash = query.indexOf(QLatin1Char('/'));
+    if (slash >= 0) {
+        // "category/package" can only match across the slash of the atom
+        const QStringView queryCategory = query.first(slash);
+        const QStringView queryName = query.sliced(slash + 1);
+        if (queryName.contains(QLatin1Char('/')) || !category.endsWith(queryCategory, Qt::CaseInsensitive)
+            || !name.startsWith(queryName, Qt::CaseInsensitive)) {
+            return m_store.summary(id).contains(query, Qt::CaseInsensitive) ? SummaryMatch : NoMatch;
+        }
+        if (category.size() != queryCategory.size()) {
+            return NameSubstring;
+        }
+        return name.size() == queryName.size() ? ExactName : NamePrefix;
+    }
+    
+    if (name.compare(query, Qt::CaseInsensitive) == 0) {
+        return ExactName;
+    }
+    if (name.startsWith(query, Qt::CaseInsensitive)) {
+        return NamePrefix;
+    }
+    if (name.contains(query, Qt::CaseInsensitive)) {
+        return NameSubstring;
+    }
+    if (category.contains(query, Qt::CaseInsensitive)) {
+        return CategoryMatch;
+    }
+    if (m_store.summary(id).contains(query, Qt::CaseInsensitive)) {
+        return SummaryMatch;
+    }
+    return NoMatch;
+}
+
+QList<PortageSearchIndex::Match> PortageSearchIndex::search(const QString &query)
+{
+    update();
+    
+    QList<PortagePackageStore::Id> ids;
+    if (!m_lastQuery.isEmpty() && query.contains(m_lastQuery, Qt::CaseInsensitive)) {
+        // Anything matching the longer query matched the previous one
+        ids = m_lastResult;
+    } else if (query.size() >= 3) {
+        ids = candidates(query);
+    } else {
+        ids.reserve(m_store.size());
+        for (PortagePackageStore::Id id = 0; id < m_store.idCount(); ++id) {
+            ids << id;
+        }
+    }
+    
+    QList<Match> matches;
+    QList<PortagePackageStore::Id> matchedIds;
+    for (PortagePackageStore::Id id : std::as_const(ids)) {
+        const Rank r = rank(id, query);
+        if (r != NoMatch) {
+            matches << Match{id, r};
+            matchedIds << id;
+        }
+    }
+    
+    std::sort(matches.begin(), matches.end(), [this](const Match &a, const Match &b) {
+        if (a.rank != b.rank) {
+            return a.rank < b.rank;
+        }
+        const QStringView nameA = m_store.name(a.id);
+        const QStringView nameB = m_store.name(b.id);
+        if (nameA.size() != nameB.size()) {
+            return nameA.size() < nameB.size();
+        }
+        return nameA.compare(nameB, Qt::CaseInsensitive) < 0;
+    });
+    
+    m_lastQuery = query;
+    m_lastResult = matchedIds;
+    return matches;
+}
+
+int PortageSearchIndex::maxTypos(qsizetype queryLength)
+{
+    // Short queries would match half the tree with a single typo
+    if (queryLength < 4) {
+        return 0;
+    }
+    if (queryLength <= 6) {
+        return 1;
+    }
+    return queryLength <= 10 ? 2 : 3;
+}
+
+QList<PortageSearchIndex::Match> PortageSearchIndex::fuzzySearch(const QString &query)
+{
+    const FuzzyMatcher matcher(query);
+    const int maxDistance = maxTypos(query.size());
+    if (!matcher.isValid() || maxDistance == 0) {
+        return {};
+    }
+    update();
+    
+    // A substitution or deletion breaks at most three trigrams of the query,
+    // an adjacent transposition (one edit in OSA distance) up to four. A name
+    // within reach must still contain the rest (postings cover more than the
+    // name, which only lets more candidates through)
+    QSet<Trigram> trigrams;
+    for (qsizetype pos = 0; pos + 3 <= query.size(); ++pos) {
+        trigrams.insert(trigramAt(query, pos));
+    }
+    const qsizetype minShared = trigrams.size() - 4 * maxDistance;
+    
+    QList<PortagePackageStore::Id> ids;
+    if (minShared > 0) {
+        QList<quint8> shared(m_store.idCount(), 0);
+        for (Trigram trigram : std::as_const(trigrams)) {
+            const auto it = m_postings.constFind(trigram);
+            if (it == m_postings.constEnd()) {
+                continue;
+            }
+            for (PortagePackageStore::Id id : it.value()) {
+                if (shared[id] < 255 && ++shared[id] == minShared) {
+                    ids << id;
+                }
+            }
+        }
+    } else {
+        // Too short for the filter, the length bound in FuzzyMatcher still skips most names
+        ids.reserve(m_store.size());
+        for (PortagePackageStore::Id id = 0; id < m_store.idCount(); ++id) {
+            ids << id;
+        }
+    }
+    
+    QList<Match> matches;
+    for (PortagePackageStore::Id id : std::as_const(ids)) {
+        if (!m_store.contains(id)) {
+            continue;
+        }
+        const int distance = matcher.distance(m_store.name(id), maxDistance);
+        if (distance <= maxDistance) {
+            matches << Match{id, FuzzyName, quint8(distance)};
+        }
+    }
+    
+    // There are no download counts, installed packages are the best popularity hint we have
+    std::sort(matches.begin(), matches.end(), [this](const Match &a, const Match &b) {
+        if (a.distance != b.distance) {
+            return a.distance < b.distance;
+        }
+        const bool installedA = m_store.hasFlag(a.id, PortagePackageStore::Installed);
+        const bool installedB = m_store.hasFlag(b.id, PortagePackageStore::Installed);
+        if (installedA != installedB) {
+            return installedA;
+        }
+        const QStringView nameA = m_store.name(a.id);
+        const QStringView nameB = m_store.name(b.id);
+        if (nameA.size() != nameB.size()) {
+            return nameA.size() < nameB.size();
+        }
+        return nameA.compare(nameB, Qt::CaseInsensitive) < 0;
+    });
+    return matches;
+}
+
+qsizetype PortageSearchIndex::memoryUsage() const
+{
+    qsizetype bytes = m_postings.capacity() * qsizetype(sizeof(Trigram) + sizeof(QList<PortagePackageStore::Id>));
+    for (const QList<PortagePackageStore::Id> &postings : m_postings) {
+        bytes += postings.capacity() * qsizetype(sizeof(PortagePackageStore::Id));
+    }
+    return bytes;
+}
@@ -0,0 +1,91 @@
+/*
+ *   SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+
+#include "PortagePackageStore.h"
+
+/**
+ * @brief Trigram index over the package store for text search
+ *
+ * Every case-folded trigram of "category/package" and of the summary maps
+ * to a sorted list of store ids. A query intersects the lists of its
+ * trigrams (shortest first), verifies the few remaining candidates and
+ * ranks them: exact name, name prefix, name substring, category, summary.
+ * Queries shorter than three characters have no trigrams and scan the
+ * store instead.
+ *
+ * Ids are appended to the store, never reused, so new packages are
+ * indexed lazily on the next query. Changed summaries are re-indexed via
+ * invalidate(), stale postings of removed rows are dropped by verification.
+ *
+ * The last result is kept: a query that extends it (the user typed
+ * another character) only re-checks those matches.
+ *
+ * fuzzySearch() is the fallback for misspelled names: a bounded edit
+ * distance (FuzzyMatcher) against every package name that passes a length
+ * and shared-trigram filter.
+ */
+class PortageSearchIndex
+{
+public:
+    enum Rank : quint8 {
+        ExactName,
+        NamePrefix,
+        NameSubstring,
+        CategoryMatch,
+        SummaryMatch,
+        FuzzyName,
+        NoMatch,
+    };
+
+    struct Match {
+        PortagePackageStore::Id id;
+        Rank rank;
+        quint8 distance = 0; // edit distance of FuzzyName matches
+    };
+
+    explicit PortageSearchIndex(const PortagePackageStore &store);
+
+    // Ranked matches, best first
+    QList<Match> search(const QString &query);
+
+    // Package names within a few typos of the query, closest and installed ones first
+    QList<Match> fuzzySearch(const QString &query);
+
+    // Summary of a package changed
+    void invalidate(PortagePackageStore::Id id);
+
+    // Higher is better, for StreamResult::sortScore
+    static uint sortScore(const Match &match) { return uint(NoMatch - match.rank) * 20 - match.distance; }
+
+    qsizetype memoryUsage() const;
+
+private:
+    using Trigram = quint64;
+
+    void update();
+    void indexText(PortagePackageStore::Id id, QStringView text, bool sortedInsert);
+    Rank rank(PortagePackageStore::Id id, QStringView query) const;
+    QList<PortagePackageStore::Id> candidates(QStringView query) const;
+
+    static Trigram trigramAt(QStringView text, qsizetype pos);
+    static int maxTypos(qsizetype queryLength);
+
+    const PortagePackageStore &m_store;
+    QHash<Trigram, QList<PortagePackageStore::Id>> m_postings; // sorted ascending
+    PortagePackageStore::Id m_indexedIds = 0;
+    QSet<PortagePackageStore::Id> m_dirty;
+
+    // Refinement of the previous query, only valid while the store is unchanged
+    int m_storeSize = 0;
+    QString m_lastQuery;
+    QList<PortagePackageStore::Id> m_lastResult;
+};
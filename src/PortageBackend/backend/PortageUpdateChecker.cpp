@@ -0,0 +1,249 @@
+/*
+ *   SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include "PortageUpdateChecker.h"
+#include "../config/PortageConfigIndex.h"
+#include "../config/PortageProfileStack.h"
+#include "../repository/PortageMetadataCache.h"
+#include "../utils/PortagePaths.h"
+
+#include <QDebug>
+#include <QSysInfo>
+#include <QtConcurrent>
+
+PortageUpdateChecker::PortageUpdateChecker(const QStringList &repositoryLocations)
+{
+    PortageProfileStack &profile = PortageProfileStack::instance();
+    
+    // ARCH comes from the profile, the CPU only decides when no profile is selected
+    m_arch = profile.value(QStringLiteral("ARCH")).trimmed();
+    if (m_arch.isEmpty()) {
+        m_arch = systemArch();
+    }
+    
+    // ACCEPT_KEYWORDS is already stacked over the profile and make.conf, the stable arch is the default
+    m_acceptKeywords.insert(m_arch);
+    const QStringList acceptKeywords = profile.value(QStringLiteral("ACCEPT_KEYWORDS"))
+                                           .split(QLatin1Char(' '), Qt::SkipEmptyParts);
+    for (const QString &keyword : acceptKeywords) {
+        if (keyword == QLatin1String("-*")) {
+            m_acceptKeywords.clear();
+        } else if (keyword.startsWith(QLatin1Char('-'))) {
+            m_acceptKeywords.remove(keyword.mid(1));
+        } else {
+            m_acceptKeywords.insert(keyword);
+        }
+    }
+    
+    PortageConfigIndex &config = PortageConfigIndex::instance();
+    const QList<PortageConfigIndex::Entry> keywordEntries = config.entries(PortageConfigIndex::PackageAcceptKeywords);
+    for (const PortageConfigIndex::Entry &entry : keywordEntries) {
+        if (!entry.spec.isValid()) {
+            continue;
+        }
+        // A bare atom accepts the testing keyword of the arch
+        QStringList keywords = entry.values;
+        if (keywords.isEmpty()) {
+            keywords << QLatin1Char('~') + m_arch;
+        }
+        m_packageKeywords[entry.spec.hasWildcard() ? QString() : entry.spec.atom().toLower()]
+            << KeywordEntry{entry.spec, keywords};
+    }
+    
+    QList<PortageConfigIndex::Entry> maskEntries;
+    for (const QString &location : repositoryLocations) {
+        maskEntries << PortageConfigIndex::readEntries(location + QLatin1Char('/') + QLatin1String(PortagePaths::REPO_PACKAGE_MASK));
+    }
+    maskEntries << profile.packageMasks();
+    maskEntries << config.entries(PortageConfigIndex::PackageMask);
+    addSpecs(m_masks, maskEntries);
+    addSpecs(m_unmasks, config.entries(PortageConfigIndex::PackageUnmask));
+}
+
+QString PortageUpdateChecker::systemArch()
+{
+    const QString cpu = QSysInfo::currentCpuArchitecture();
+    if (cpu == QLatin1String("x86_64")) {
+        return QStringLiteral("amd64");
+    }
+    if (cpu == QLatin1String("i386")) {
+        return QStringLiteral("x86");
+    }
+    if (cpu.startsWith(QLatin1String("power64"))) {
+        return QStringLiteral("ppc64");
+    }
+    if (cpu.startsWith(QLatin1String("power"))) {
+        return QStringLiteral("ppc");
+    }
+    if (cpu.startsWith(QLatin1String("riscv"))) {
+        return QStringLiteral("riscv");
+    }
+    if (cpu.startsWith(QLatin1String("loongarch"))) {
+        return QStringLiteral("loong");
+    }
+    if (cpu.startsWith(QLatin1String("mips"))) {
+        return QStringLiteral("mips");
+    }
+    if (cpu.startsWith(QLatin1String("sparc"))) {
+        return QStringLiteral("sparc");
+    }
+    if (cpu.startsWith(QLatin1String("s390"))) {
+        return QStringLiteral("s390");
+    }
+    // arm, arm64, alpha, hppa, ia64 are spelled the same
+    return cpu;
+}
+
+void PortageUpdateChecker::addSpecs(QHash<QString, QList<PortageAtomSpec>> &specs,
+                                    const QList<PortageConfigIndex::Entry> &entries)
+{
+    // "-atom" in a later file drops a mask added earlier, e.g. by a repository
+    QSet<QString> removed;
+    for (const PortageConfigIndex::Entry &entry : entries) {
+        if (entry.atom.startsWith(QLatin1Char('-'))) {
+            removed.insert(entry.atom.mid(1));
+        }
+    }
+    
+    for (const PortageConfigIndex::Entry &entry : entries) {
+        if (!entry.spec.isValid() || removed.contains(entry.atom)) {
+            continue;
+        }
+        specs[entry.spec.hasWildcard() ? QString() : entry.spec.atom().toLower()] << entry.spec;
+    }
+}
+
+bool PortageUpdateChecker::anyMatches(const QHash<QString, QList<PortageAtomSpec>> &specs, const QString &atom,
+                                      const EbuildMetadata &metadata, const QString &repository)
+{
+    for (const QString &key : {atom.toLower(), QString()}) {
+        const auto it = specs.constFind(key);
+        if (it == specs.constEnd()) {
+            continue;
+        }
+        for (const PortageAtomSpec &spec : it.value()) {
+            if (spec.matches(atom, metadata.version, metadata.slot, repository)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool PortageUpdateChecker::isKeywordAccepted(const QString &atom, const EbuildMetadata &metadata,
+                                             const QString &repository) const
+{
+    auto accepts = [](const QSet<QString> &accepted, const QStringList &keywords) {
+        if (accepted.contains(QStringLiteral("**"))) {
+            return true;
+        }
+        for (const QString &keyword : keywords) {
+            if (keyword.startsWith(QLatin1Char('-'))) {
+                continue;
+            }
+            if (accepted.contains(keyword)) {
+                return true;
+            }
+            // "*" accepts any stable keyword, "~*" any testing one
+            if (accepted.contains(keyword.startsWith(QLatin1Char('~')) ? QStringLiteral("~*") : QStringLiteral("*"))) {
+                return true;
+            }
+        }
+        return false;
+    };
+    
+    const QStringList keywords = metadata.keywords.split(QLatin1Char(' '), Qt::SkipEmptyParts);
+    if (accepts(m_acceptKeywords, keywords)) {
+        return true;
+    }
+    
+    // Per-package additions, only built when an entry matches
+    QSet<QString> accepted;
+    for (const QString &key : {atom.toLower(), QString()}) {
+        const auto it = m_packageKeywords.constFind(key);
+        if (it == m_packageKeywords.constEnd()) {
+            continue;
+        }
+        for (const KeywordEntry &entry : it.value()) {
+            if (entry.spec.matches(atom, metadata.version, metadata.slot, repository)) {
+                for (const QString &keyword : entry.keywords) {
+                    accepted.insert(keyword);
+                }
+            }
+        }
+    }
+    return !accepted.isEmpty() && accepts(accepted, keywords);
+}
+
+bool PortageUpdateChecker::isMasked(const QString &atom, const EbuildMetadata &metadata, const QString &repository) const
+{
+    return anyMatches(m_masks, atom, metadata, repository) && !anyMatches(m_unmasks, atom, metadata, repository);
+}
+
+bool PortageUpdateChecker::isVisible(const QString &atom, const EbuildMetadata &metadata, const QString &repository) const
+{
+    return isKeywordAccepted(atom, metadata, repository) && !isMasked(atom, metadata, repository);
+}
+
+QString PortageUpdateChecker::bestVisibleVersion(const UpdateCandidate &candidate) const
+{
+    PortageMetadataCache &cache = PortageMetadataCache::instance();
+    const QString slot = candidate.slot.section(QLatin1Char('/'), 0, 0);
+    
+    PortageVersion best;
+    QString bestVersion;
+    for (const auto &repo : candidate.repositories) {
+        const QList<EbuildMetadata> versions = cache.packageMetadata(repo.second, candidate.atom);
+        for (const EbuildMetadata &md : versions) {
+            // SLOT defaults to 0 when the ebuild could not be read
+            const QString mdSlot = md.slot.isEmpty() ? QStringLiteral("0") : md.slot.section(QLatin1Char('/'), 0, 0);
+            if (!slot.isEmpty() && mdSlot != slot) {
+                continue;
+            }
+            
+            const PortageVersion version(md.version);
+            if (!version.isValid() || (!bestVersion.isEmpty() && version <= best)) {
+                continue;
+            }
+            if (isVisible(candidate.atom, md, repo.first)) {
+                best = version;
+                bestVersion = md.version;
+            }
+        }
+    }
+    return bestVersion;
+}
+
+QHash<QString, QString> PortageUpdateChecker::findUpdates(const QList<UpdateCandidate> &candidates)
+{
+    QStringList locations;
+    for (const UpdateCandidate &candidate : candidates) {
+        for (const auto &repo : candidate.repositories) {
+            if (!locations.contains(repo.second)) {
+                locations << repo.second;
+            }
+        }
+    }
+    
+    const PortageUpdateChecker checker(locations);
+    const QList<QString> best = QtConcurrent::blockingMapped(candidates, [&checker](const UpdateCandidate &candidate) {
+        return checker.bestVisibleVersion(candidate);
+    });
+    
+    QHash<QString, QString> updates;
+    for (qsizetype i = 0; i < candidates.size(); ++i) {
+        const QString &version = best.at(i);
+        if (version.isEmpty() || PortageVersion::compare(version, candidates.at(i).installedVersion) <= 0) {
+            continue;
+        }
+        // Several slots with an update: offer the newest version
+        const QString &atom = candidates.at(i).atom;
+        const auto existing = updates.constFind(atom);
+        if (existing == updates.constEnd() || PortageVersion::compare(version, existing.value()) > 0) {
+            updates.insert(atom, version);
+        }
+    }
+    return updates;
+}
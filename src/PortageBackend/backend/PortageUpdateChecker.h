@@ -0,0 +1,79 @@
+/*
+ *   SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+#include "../config/PortageConfigIndex.h"
+#include "../utils/PortageAtomSpec.h"
+
+struct EbuildMetadata;
+
+/**
+ * @brief An installed slot of a package to check for updates
+ */
+struct UpdateCandidate {
+    QString atom;
+    QString installedVersion;
+    QString slot;
+    QList<QPair<QString, QString>> repositories; // (name, location) of every repository carrying the atom
+};
+
+/**
+ * @brief Native update detection, without running emerge
+ *
+ * A version is visible when one of its KEYWORDS is accepted by
+ * ACCEPT_KEYWORDS plus the matching package.accept_keywords entries, and
+ * it is not masked by a repository's profiles/package.mask, the profile
+ * stack's package.mask or /etc/portage/package.mask unless package.unmask
+ * lifts the mask. An installed package is upgradeable when one of its
+ * installed slots has a newer visible version in any repository carrying it.
+ *
+ * The configuration is taken from PortageProfileStack and
+ * PortageConfigIndex once when the checker is created, after that it is
+ * immutable and can be shared by worker threads. Ebuild metadata comes
+ * from PortageMetadataCache.
+ */
+class PortageUpdateChecker
+{
+public:
+    explicit PortageUpdateChecker(const QStringList &repositoryLocations);
+
+    // Newest visible version in the candidate's slot, empty if there is none
+    QString bestVisibleVersion(const UpdateCandidate &candidate) const;
+
+    bool isVisible(const QString &atom, const EbuildMetadata &metadata, const QString &repository) const;
+
+    // atom -> newer visible version, the newest one when several slots have an update;
+    // runs on the thread pool and blocks
+    static QHash<QString, QString> findUpdates(const QList<UpdateCandidate> &candidates);
+
+    // Keyword of the running architecture (amd64, arm64, ...)
+    static QString systemArch();
+
+private:
+    struct KeywordEntry {
+        PortageAtomSpec spec;
+        QStringList keywords;
+    };
+
+    bool isKeywordAccepted(const QString &atom, const EbuildMetadata &metadata, const QString &repository) const;
+    bool isMasked(const QString &atom, const EbuildMetadata &metadata, const QString &repository) const;
+
+    static void addSpecs(QHash<QString, QList<PortageAtomSpec>> &specs, const QList<PortageConfigIndex::Entry> &entries);
+    static bool anyMatches(const QHash<QString, QList<PortageAtomSpec>> &specs, const QString &atom,
+                           const EbuildMetadata &metadata, const QString &repository);
+
+    QString m_arch;
+    QSet<QString> m_acceptKeywords;
+    QHash<QString, QList<KeywordEntry>> m_packageKeywords; // lowercase atom ("" for wildcards) -> entries
+    QHash<QString, QList<PortageAtomSpec>> m_masks;
+    QHash<QString, QList<PortageAtomSpec>> m_unmasks;
+};
@@ -0,0 +1,245 @@
+/*
+ *   SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+/*
+ * Times the FuzzyMatcher kernel against a plain dynamic programming table.
+ *
+ *   portage_fuzzy_benchmark [repository]
+ *
+ * Every query is a package name with as many random typos as
+ * PortageSearchIndex::maxTypos() allows for its length, matched against all
+ * package names of the repository (or ~30k synthetic ones). This is the scan
+ * without the trigram prefilter, so the per-query times are an upper bound for
+ * the fuzzy fallback. Both sides must find the same names; a mismatch fails
+ * the run.
+ */
+
+#include "../utils/FuzzyMatcher.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QStringList>
+
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+constexpr int SYNTHETIC_NAMES = 30000;
+constexpr int QUERIES = 300;
+constexpr qint64 BUDGET_NS = 20 * 1000 * 1000; // the fuzzy fallback's share of a keystroke
+
+QStringList repositoryNames(const QString &repoPath)
+{
+    QStringList names;
+    const QDir repo(repoPath);
+    for (const QString &category : repo.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        // Packages live in "<group>-<name>" categories, skip metadata/, profiles/, eclass/ ...
+        if (!category.contains(QLatin1Char('-')) && category != QLatin1String("virtual")) {
+            continue;
+        }
+        names << QDir(repo.filePath(category)).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    }
+    return names;
+}
+
+QStringList syntheticNames()
+{
+    // Pronounceable parts joined with dashes, roughly the shape of real package names
+    static const char *const parts[] = {"lib", "kde", "gtk", "py", "qt", "x", "net", "font", "dev", "tools",
+                                        "media", "office", "vlc", "core", "gnome", "perl", "ruby", "data",
+                                        "video", "audio", "crypt", "zip", "sql", "server", "client", "utils"};
+    constexpr int partCount = int(sizeof(parts) / sizeof(parts[0]));
+    QRandomGenerator rng(2025);
+
+    QStringList names;
+    names.reserve(SYNTHETIC_NAMES);
+    while (names.size() < SYNTHETIC_NAMES) {
+        QString name;
+        const int words = 1 + rng.bounded(3);
+        for (int w = 0; w < words; ++w) {
+            if (w > 0) {
+                name += QLatin1Char('-');
+            }
+            name += QLatin1String(parts[rng.bounded(partCount)]);
+            // A random tail keeps names distinct
+            const int tail = rng.bounded(5);
+            for (int c = 0; c < tail; ++c) {
+                name += QChar(char16_t(u'a' + rng.bounded(26)));
+            }
+        }
+        if (rng.bounded(8) == 0) {
+            name += QString::number(rng.bounded(10));
+        }
+        names << name;
+    }
+    return names;
+}
+
+// Same thresholds as PortageSearchIndex::maxTypos()
+int maxTypos(qsizetype length)
+{
+    if (length < 4) {
+        return 0;
+    }
+    if (length <= 6) {
+        return 1;
+    }
+    return length <= 10 ? 2 : 3;
+}
+
+QString withTypos(QString name, int typos, QRandomGenerator &rng)
+{
+    for (int t = 0; t < typos && name.size() > 2; ++t) {
+        const qsizetype at = rng.bounded(int(name.size() - 1));
+        const QChar letter(char16_t(u'a' + rng.bounded(26)));
+        switch (rng.bounded(4)) {
+        case 0:
+            name[at] = letter;
+            break;
+        case 1:
+            name.remove(at, 1);
+            break;
+        case 2:
+            name.insert(at, letter);
+            break;
+        default:
+            std::swap(name[at], name[at + 1]);
+            break;
+        }
+    }
+    return name;
+}
+
+// Optimal string alignment distance with the full table, case-insensitive like FuzzyMatcher
+int tableDistance(QStringView a, QStringView b)
+{
+    const qsizetype n = a.size();
+    const qsizetype m = b.size();
+    QList<int> beforePrevious(m + 1);
+    QList<int> previous(m + 1);
+    QList<int> current(m + 1);
+    for (qsizetype j = 0; j <= m; ++j) {
+        previous[j] = int(j);
+    }
+
+    for (qsizetype i = 1; i <= n; ++i) {
+        current[0] = int(i);
+        const QChar ca = a.at(i - 1).toCaseFolded();
+        for (qsizetype j = 1; j <= m; ++j) {
+            const QChar cb = b.at(j - 1).toCaseFolded();
+            int d = std::min({previous[j] + 1, current[j - 1] + 1, previous[j - 1] + (ca == cb ? 0 : 1)});
+            if (i > 1 && j > 1 && ca == b.at(j - 2).toCaseFolded() && a.at(i - 2).toCaseFolded() == cb) {
+                d = std::min(d, beforePrevious[j - 2] + 1);
+            }
+            current[j] = d;
+        }
+        std::swap(beforePrevious, previous);
+        std::swap(previous, current);
+    }
+    return previous[m];
+}
+
+struct Timings {
+    QList<qint64> perQuery; // ns
+    qsizetype matches = 0;
+};
+
+void report(const char *name, Timings timings)
+{
+    QList<qint64> &ns = timings.perQuery;
+    std::sort(ns.begin(), ns.end());
+    qint64 total = 0;
+    for (qint64 t : std::as_const(ns)) {
+        total += t;
+    }
+    const auto percentile = [&ns](int p) {
+        return ns.at(qMin(ns.size() - 1, ns.size() * p / 100)) / 1e6;
+    };
+    const qsizetype overBudget = std::count_if(ns.cbegin(), ns.cend(), [](qint64 t) {
+        return t > BUDGET_NS;
+    });
+    std::printf("  %-36s mean %7.2f ms  p50 %7.2f ms  p99 %7.2f ms  max %7.2f ms  over 20 ms: %lld\n", name,
+                total / 1e6 / qMax<qsizetype>(1, ns.size()), percentile(50), percentile(99), ns.last() / 1e6,
+                qlonglong(overBudget));
+}
+}
+
+int main(int argc, char **argv)
+{
+    const QString repoPath = argc > 1 ? QString::fromLocal8Bit(argv[1]) : QString();
+    QStringList names = repoPath.isEmpty() ? QStringList() : repositoryNames(repoPath);
+    const bool synthetic = names.isEmpty();
+    if (synthetic) {
+        if (!repoPath.isEmpty()) {
+            std::printf("No packages under %s, using synthetic names\n", qPrintable(repoPath));
+        }
+        names = syntheticNames();
+    }
+
+    QRandomGenerator rng(7);
+    QStringList queries;
+    while (queries.size() < QUERIES) {
+        const QString &name = names.at(rng.bounded(int(names.size())));
+        const int typos = maxTypos(name.size());
+        if (typos > 0) {
+            queries << withTypos(name, 1 + rng.bounded(typos), rng);
+        }
+    }
+    std::printf("%d queries against %lld names (%s)\n\n", QUERIES, qlonglong(names.size()),
+                synthetic ? "synthetic" : qPrintable(repoPath));
+
+    // Names the kernel accepted, per query, to hold the table against
+    QList<QList<qsizetype>> kernelHits(queries.size());
+    Timings kernel;
+    for (qsizetype q = 0; q < queries.size(); ++q) {
+        const int maxDistance = maxTypos(queries.at(q).size());
+        QElapsedTimer timer;
+        timer.start();
+        const FuzzyMatcher matcher(queries.at(q));
+        for (qsizetype i = 0; i < names.size(); ++i) {
+            if (matcher.distance(names.at(i), maxDistance) <= maxDistance) {
+                kernelHits[q] << i;
+            }
+        }
+        kernel.perQuery << timer.nsecsElapsed();
+        kernel.matches += kernelHits.at(q).size();
+    }
+
+    // Same length bound as the kernel, so the difference is the distance computation itself
+    Timings table;
+    qsizetype mismatches = 0;
+    for (qsizetype q = 0; q < queries.size(); ++q) {
+        const QString &query = queries.at(q);
+        const int maxDistance = maxTypos(query.size());
+        QList<qsizetype> hits;
+        QElapsedTimer timer;
+        timer.start();
+        for (qsizetype i = 0; i < names.size(); ++i) {
+            if (qAbs(names.at(i).size() - query.size()) <= maxDistance
+                && tableDistance(query, names.at(i)) <= maxDistance) {
+                hits << i;
+            }
+        }
+        table.perQuery << timer.nsecsElapsed();
+        table.matches += hits.size();
+        if (hits != kernelHits.at(q)) {
+            ++mismatches;
+            std::printf("  mismatch for \"%s\": kernel %lld names, table %lld\n", qPrintable(query),
+                        qlonglong(kernelHits.at(q).size()), qlonglong(hits.size()));
+        }
+    }
+
+    std::printf("Full scan per query, %lld matches in total:\n", qlonglong(kernel.matches));
+    report("FuzzyMatcher (bit-parallel)", kernel);
+    report("dynamic programming table", table);
+
+    if (mismatches > 0) {
+        std::printf("\n%lld queries matched different names\n", qlonglong(mismatches));
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,226 @@
+/*
+ *   SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+/*
+ * Times PortageVersion against the std::greater<QString> ordering it replaced.
+ *
+ *   portage_version_benchmark [repository]
+ *
+ * With a repository path (e.g. /var/db/repos/gentoo) the versions of every
+ * ebuild in it are used, otherwise a fixed synthetic set. Each figure is the
+ * best of several rounds.
+ */
+
+#include "../utils/PortageVersion.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QPair>
+#include <QRandomGenerator>
+#include <QStringList>
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <limits>
+
+namespace
+{
+constexpr int ROUNDS = 5;
+constexpr int SYNTHETIC_PACKAGES = 20000;
+
+quint64 sink = 0; // keeps the measured work from being optimized away
+
+// <category>/<package>/<package>-<version>.ebuild, one list per package
+QList<QStringList> repositoryVersions(const QString &repoPath)
+{
+    QList<QStringList> packages;
+    const QDir repo(repoPath);
+    for (const QString &category : repo.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        const QDir categoryDir(repo.filePath(category));
+        for (const QString &package : categoryDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+            const QString prefix = package + QLatin1Char('-');
+            QStringList versions;
+            const QStringList ebuilds =
+                QDir(categoryDir.filePath(package)).entryList({QStringLiteral("*.ebuild")}, QDir::Files);
+            for (const QString &ebuild : ebuilds) {
+                if (ebuild.startsWith(prefix)) {
+                    versions << ebuild.mid(prefix.size(), ebuild.size() - prefix.size() - 7);
+                }
+            }
+            if (!versions.isEmpty()) {
+                packages << versions;
+            }
+        }
+    }
+    return packages;
+}
+
+QString syntheticVersion(QRandomGenerator &rng)
+{
+    // Snapshot style dates now and then, they have the longest components
+    if (rng.bounded(20) == 0) {
+        return QString::number(20200101 + rng.bounded(60000));
+    }
+
+    QString version = QString::number(rng.bounded(30));
+    const int components = rng.bounded(4);
+    for (int i = 0; i < components; ++i) {
+        version += QLatin1Char('.');
+        version += QString::number(rng.bounded(i == 0 ? 30 : 200));
+    }
+    if (rng.bounded(10) == 0) {
+        version += QChar(char16_t(u'a' + rng.bounded(3)));
+    }
+    if (rng.bounded(5) == 0) {
+        static const char *const suffixes[] = {"_alpha", "_beta", "_pre", "_rc", "_p"};
+        version += QLatin1String(suffixes[rng.bounded(5)]);
+        version += QString::number(rng.bounded(1, 10));
+    }
+    if (rng.bounded(3) == 0) {
+        version += QStringLiteral("-r") + QString::number(rng.bounded(1, 5));
+    }
+    return version;
+}
+
+QList<QStringList> syntheticVersions()
+{
+    QRandomGenerator rng(2025);
+    QList<QStringList> packages;
+    packages.reserve(SYNTHETIC_PACKAGES);
+    for (int i = 0; i < SYNTHETIC_PACKAGES; ++i) {
+        QStringList versions;
+        const int count = 1 + rng.bounded(3);
+        for (int v = 0; v < count; ++v) {
+            versions << syntheticVersion(rng);
+        }
+        packages << versions;
+    }
+    return packages;
+}
+
+// Unshared copies, so no round sorts already sorted lists or pays for a detach while timed
+QList<QStringList> detachedCopy(const QList<QStringList> &packages)
+{
+    QList<QStringList> copy;
+    copy.reserve(packages.size());
+    for (const QStringList &versions : packages) {
+        copy << QStringList(versions.cbegin(), versions.cend());
+    }
+    return copy;
+}
+
+template<typename Setup, typename Run>
+qint64 bestOf(Setup setup, Run run)
+{
+    qint64 best = std::numeric_limits<qint64>::max();
+    for (int round = 0; round < ROUNDS; ++round) {
+        auto input = setup();
+        QElapsedTimer timer;
+        timer.start();
+        run(input);
+        best = std::min(best, timer.nsecsElapsed());
+    }
+    return best;
+}
+
+void report(const char *name, qint64 ns, qsizetype operations, const char *unit)
+{
+    std::printf("  %-40s %9.2f ms %10.1f ns/%s\n", name, ns / 1e6, double(ns) / qMax<qsizetype>(1, operations), unit);
+}
+}
+
+int main(int argc, char **argv)
+{
+    const QString repoPath = argc > 1 ? QString::fromLocal8Bit(argv[1]) : QString();
+    QList<QStringList> packages = repoPath.isEmpty() ? QList<QStringList>() : repositoryVersions(repoPath);
+    const bool synthetic = packages.isEmpty();
+    if (synthetic) {
+        if (!repoPath.isEmpty()) {
+            std::printf("No ebuilds under %s, using synthetic versions\n", qPrintable(repoPath));
+        }
+        packages = syntheticVersions();
+    }
+
+    QStringList all;
+    for (const QStringList &versions : std::as_const(packages)) {
+        all << versions;
+    }
+    std::printf("%lld versions in %lld packages (%s)\n", qlonglong(all.size()), qlonglong(packages.size()),
+                synthetic ? "synthetic" : qPrintable(repoPath));
+
+    // Where the old order disagrees with PMS (1.10 < 1.9, 1.0_rc1 > 1.0, ...)
+    qsizetype misordered = 0;
+    for (const QStringList &versions : std::as_const(packages)) {
+        QStringList byString = versions;
+        std::sort(byString.begin(), byString.end(), std::greater<QString>());
+        byString.removeDuplicates();
+        QStringList byPms = versions;
+        PortageVersion::sortDescending(byPms);
+        if (byString != byPms) {
+            ++misordered;
+        }
+    }
+    std::printf("%lld packages ordered differently by the string comparison\n\n", qlonglong(misordered));
+
+    std::printf("Sorting every package's versions, newest first:\n");
+    const auto copies = [&packages]() {
+        return detachedCopy(packages);
+    };
+    report("std::sort, std::greater<QString>", bestOf(copies, [](QList<QStringList> &input) {
+               for (QStringList &versions : input) {
+                   std::sort(versions.begin(), versions.end(), std::greater<QString>());
+                   sink += versions.size();
+               }
+           }), packages.size(), "package");
+    report("PortageVersion::sortDescending", bestOf(copies, [](QList<QStringList> &input) {
+               for (QStringList &versions : input) {
+                   PortageVersion::sortDescending(versions);
+                   sink += versions.size();
+               }
+           }), packages.size(), "package");
+
+    // Each version against a random other one, the same pairs for every variant
+    QRandomGenerator rng(7);
+    QList<QPair<qsizetype, qsizetype>> pairs;
+    pairs.reserve(all.size());
+    for (qsizetype i = 0; i < all.size(); ++i) {
+        pairs << qMakePair(i, qsizetype(rng.bounded(quint32(all.size()))));
+    }
+    const auto noSetup = []() {
+        return 0;
+    };
+
+    std::printf("\nComparing %lld pairs:\n", qlonglong(pairs.size()));
+    report("QString::compare", bestOf(noSetup, [&](int) {
+               for (const auto &pair : std::as_const(pairs)) {
+                   sink += all.at(pair.first).compare(all.at(pair.second)) < 0;
+               }
+           }), pairs.size(), "pair");
+    report("PortageVersion::compare (parses both)", bestOf(noSetup, [&](int) {
+               for (const auto &pair : std::as_const(pairs)) {
+                   sink += PortageVersion::compare(all.at(pair.first), all.at(pair.second)) < 0;
+               }
+           }), pairs.size(), "pair");
+
+    QList<PortageVersion> keys;
+    const qint64 parseNs = bestOf(noSetup, [&](int) {
+        keys.clear();
+        keys.reserve(all.size());
+        for (const QString &version : std::as_const(all)) {
+            keys << PortageVersion(version);
+        }
+        sink += keys.size();
+    });
+    report("PortageVersion keys, compare only", bestOf(noSetup, [&](int) {
+               for (const auto &pair : std::as_const(pairs)) {
+                   sink += keys.at(pair.first) < keys.at(pair.second);
+               }
+           }), pairs.size(), "pair");
+    report("PortageVersion keys, parse", parseNs, all.size(), "version");
+
+    std::printf("\n(checksum %llu)\n", static_cast<unsigned long long>(sink));
+    return 0;
+}
@@ -0,0 +1,229 @@
+/*
+ * SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include "PortageCatalogCache.h"
+#include "../repository/PortageRepositoryConfig.h"
+#include "../utils/PortagePaths.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+PortageCatalogCache::PortageCatalogCache()
+{
+}
+
+QString PortageCatalogCache::cacheFilePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+        + QStringLiteral("/discover-portage/catalog.bin");
+}
+
+qint64 PortageCatalogCache::repositoryStamp(const QString &location)
+{
+    // Synced repositories carry a timestamp that changes on every sync
+    const QFileInfo timestamp(location + QLatin1Char('/') + QLatin1String(PortagePaths::REPO_TIMESTAMP));
+    if (timestamp.exists()) {
+        return timestamp.lastModified().toMSecsSinceEpoch();
+    }
+
+    // Local overlays don't have one, adding or removing a package
+    // bumps the mtime of its category directory instead
+    qint64 stamp = QFileInfo(location).lastModified().toMSecsSinceEpoch();
+    const QFileInfoList categories = QDir(location).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QFileInfo &catInfo : categories) {
+        stamp = qMax(stamp, catInfo.lastModified().toMSecsSinceEpoch());
+    }
+    return stamp;
+}
+
+QString PortageCatalogCache::repositoryKey(const QString &name, const QString &location)
+{
+    return name + QLatin1Char(':') + location;
+}
+
+QHash<QString, qint64> PortageCatalogCache::repositoryStamps()
+{
+    QHash<QString, qint64> stamps;
+
+    const PortageRepositoryConfig &config = PortageRepositoryConfig::instance();
+    const QStringList repos = config.getAllRepositoryNames();
+    for (const QString &repo : repos) {
+        const QString location = config.getRepositoryLocation(repo);
+        stamps.insert(repositoryKey(repo, location), repositoryStamp(location));
+    }
+    return stamps;
+}
+
+QHash<QString, qint64> PortageCatalogCache::combineStamps(const QHash<QString, qint64> &repoStamps,
+                                                         const QHash<QString, qint64> &vdbStamps)
+{
+    QHash<QString, qint64> stamps;
+
+    for (auto it = repoStamps.constBegin(); it != repoStamps.constEnd(); ++it) {
+        stamps.insert(QStringLiteral("repo:") + it.key(), it.value());
+    }
+    for (auto it = vdbStamps.constBegin(); it != vdbStamps.constEnd(); ++it) {
+        stamps.insert(QStringLiteral("vdb:") + it.key(), it.value());
+    }
+    return stamps;
+}
+
+QHash<QString, qint64> PortageCatalogCache::currentStamps()
+{
+    return combineStamps(repositoryStamps(), PortageInstalledReader::vdbStamps());
+}
+
+QHash<QString, RepositoryPackageEntry> PortageCatalogCache::repositoryPackages() const
+{
+    return PortageRepositoryReader::resolvePackages(m_repoAtoms);
+}
+
+bool PortageCatalogCache::load()
+{
+    m_repoAtoms.clear();
+    m_installedInfo.clear();
+
+    QFile file(cacheFilePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "PortageCatalogCache: No snapshot at" << file.fileName();
+        return false;
+    }
+
+    const qint64 size = file.size();
+    if (size < HEADER_SIZE) {
+        qDebug() << "PortageCatalogCache: Snapshot is truncated";
+        return false;
+    }
+
+    uchar *mapped = file.map(0, size);
+    if (!mapped) {
+        qDebug() << "PortageCatalogCache: Could not map" << file.fileName() << ":" << file.errorString();
+        return false;
+    }
+
+    const bool ok = parse(QByteArray::fromRawData(reinterpret_cast<const char *>(mapped), size));
+    file.unmap(mapped);
+
+    if (!ok) {
+        m_repoAtoms.clear();
+        m_installedInfo.clear();
+        return false;
+    }
+
+    qDebug() << "PortageCatalogCache: Loaded snapshot with" << m_repoAtoms.size() << "repositories and"
+             << m_installedInfo.size() << "installed packages";
+    return true;
+}
+
+bool PortageCatalogCache::parse(const QByteArray &data)
+{
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_6_5);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint32 payloadSize = 0;
+    quint16 checksum = 0;
+    in >> magic >> version >> payloadSize >> checksum;
+
+    if (magic != MAGIC || version != FORMAT_VERSION) {
+        qDebug() << "PortageCatalogCache: Snapshot format mismatch, version" << version;
+        return false;
+    }
+
+    if (qint64(payloadSize) != data.size() - HEADER_SIZE
+        || qChecksum(QByteArrayView(data.constData() + HEADER_SIZE, payloadSize)) != checksum) {
+        qDebug() << "PortageCatalogCache: Snapshot is corrupt";
+        return false;
+    }
+
+    // Check staleness before decoding the (much larger) package lists
+    quint32 stampCount = 0;
+    in >> stampCount;
+    QHash<QString, qint64> stamps;
+    for (quint32 i = 0; i < stampCount && in.status() == QDataStream::Ok; ++i) {
+        QString key;
+        qint64 stamp = 0;
+        in >> key >> stamp;
+        stamps.insert(key, stamp);
+    }
+
+    if (stamps != currentStamps()) {
+        qDebug() << "PortageCatalogCache: Snapshot is stale";
+        return false;
+    }
+
+    in >> m_repoAtoms;
+
+    quint32 installedCount = 0;
+    in >> installedCount;
+    m_installedInfo.reserve(installedCount);
+    for (quint32 i = 0; i < installedCount && in.status() == QDataStream::Ok; ++i) {
+        QString atom;
+        InstalledPackageInfo info;
+        in >> atom >> info;
+        m_installedInfo.insert(atom, info);
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        qDebug() << "PortageCatalogCache: Snapshot ended unexpectedly";
+        return false;
+    }
+
+    return true;
+}
+
+bool PortageCatalogCache::save(const QHash<QString, qint64> &stamps, const QHash<QString, QStringList> &repoAtoms,
+                               const QHash<QString, InstalledPackageInfo> &installedInfo)
+{
+    QByteArray payload;
+    {
+        QDataStream out(&payload, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_6_5);
+
+        out << quint32(stamps.size());
+        for (auto it = stamps.constBegin(); it != stamps.constEnd(); ++it) {
+            out << it.key() << it.value();
+        }
+
+        out << repoAtoms;
+
+        out << quint32(installedInfo.size());
+        for (auto it = installedInfo.constBegin(); it != installedInfo.constEnd(); ++it) {
+            out << it.key() << it.value();
+        }
+    }
+
+    const QString path = cacheFilePath();
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+        qWarning() << "PortageCatalogCache: Could not create cache directory for" << path;
+        return false;
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "PortageCatalogCache: Could not open" << path << "for writing:" << file.errorString();
+        return false;
+    }
+
+    QDataStream header(&file);
+    header.setVersion(QDataStream::Qt_6_5);
+    header << MAGIC << FORMAT_VERSION << quint32(payload.size()) << qChecksum(QByteArrayView(payload));
+    file.write(payload);
+
+    if (!file.commit()) {
+        qWarning() << "PortageCatalogCache: Failed to write" << path << ":" << file.errorString();
+        return false;
+    }
+
+    qDebug() << "PortageCatalogCache: Saved snapshot," << payload.size() << "bytes";
+    return true;
+}
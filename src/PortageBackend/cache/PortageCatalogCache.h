@@ -0,0 +1,60 @@
+/*
+ * SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#pragma once
+
+#include <QHash>
+#include <QString>
+
+#include "../installed/PortageInstalledReader.h"
+#include "../repository/PortageRepositoryReader.h"
+
+/**
+ * @brief Persistent binary snapshot of the package catalog
+ *
+ * Holds the atoms of every repository together with the installed package info
+ * (version, repository, slot, USE, IUSE, description, size, build time).
+ * The file is memory-mapped on load and rejected when it is corrupt, has a
+ * different format version or when any repository's metadata/timestamp.chk
+ * or the /var/db/pkg tree changed since it was written.
+ */
+class PortageCatalogCache
+{
+public:
+    PortageCatalogCache();
+
+    // Load snapshot, returns false if missing, stale or corrupt
+    bool load();
+
+    // stamps must be taken before the data was read, so changes racing the scan leave the snapshot stale
+    bool save(const QHash<QString, qint64> &stamps, const QHash<QString, QStringList> &repoAtoms,
+              const QHash<QString, InstalledPackageInfo> &installedInfo);
+
+    QHash<QString, QStringList> repositoryAtoms() const { return m_repoAtoms; }
+    QHash<QString, RepositoryPackageEntry> repositoryPackages() const;
+    QHash<QString, InstalledPackageInfo> installedPackages() const { return m_installedInfo; }
+
+    static QString cacheFilePath();
+
+    // Stamps the snapshot is validated against (repository mtimes, vdb counter and category mtimes)
+    static QHash<QString, qint64> currentStamps();
+    static QHash<QString, qint64> combineStamps(const QHash<QString, qint64> &repoStamps,
+                                                const QHash<QString, qint64> &vdbStamps);
+    static qint64 repositoryStamp(const QString &location);
+    
+    // Stamp of every configured repository, keyed by repositoryKey()
+    static QHash<QString, qint64> repositoryStamps();
+    static QString repositoryKey(const QString &name, const QString &location);
+
+private:
+    bool parse(const QByteArray &data);
+
+    static constexpr quint32 MAGIC = 0x50434154; // "PCAT"
+    static constexpr quint32 FORMAT_VERSION = 5;
+    static constexpr int HEADER_SIZE = 14; // magic + version + payload size + checksum
+
+    QHash<QString, QStringList> m_repoAtoms; // repository -> atoms
+    QHash<QString, InstalledPackageInfo> m_installedInfo;
+};
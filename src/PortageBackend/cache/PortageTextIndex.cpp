@@ -0,0 +1,519 @@
+/*
+ * SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include "PortageTextIndex.h"
+#include "PortageCatalogCache.h"
+#include "../repository/PortageMetadataCache.h"
+#include "../repository/PortageMetadataXml.h"
+#include "../repository/PortageRepositoryReader.h"
+#include "../utils/AtomParser.h"
+#include "../utils/FsUtils.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+// BM25 parameters, the usual defaults
+constexpr float K1 = 1.2f;
+constexpr float B = 0.75f;
+
+bool isStopword(QStringView word)
+{
+    static const QSet<QString> stopwords = {
+        QStringLiteral("an"),   QStringLiteral("and"),  QStringLiteral("are"),  QStringLiteral("as"),
+        QStringLiteral("at"),   QStringLiteral("be"),   QStringLiteral("by"),   QStringLiteral("for"),
+        QStringLiteral("from"), QStringLiteral("in"),   QStringLiteral("is"),   QStringLiteral("it"),
+        QStringLiteral("of"),   QStringLiteral("on"),   QStringLiteral("or"),   QStringLiteral("that"),
+        QStringLiteral("the"),  QStringLiteral("this"), QStringLiteral("to"),   QStringLiteral("with"),
+    };
+    return stopwords.contains(word.toString());
+}
+}
+
+QString PortageTextIndex::cacheFilePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+        + QStringLiteral("/discover-portage/textindex.bin");
+}
+
+QStringList PortageTextIndex::tokenize(QStringView text)
+{
+    QStringList words;
+    qsizetype start = -1;
+    for (qsizetype i = 0; i <= text.size(); ++i) {
+        const bool wordChar = i < text.size() && text.at(i).isLetterOrNumber();
+        if (wordChar && start < 0) {
+            start = i;
+        } else if (!wordChar && start >= 0) {
+            const QString word = text.sliced(start, i - start).toString().toCaseFolded();
+            if (word.size() >= 2 && !isStopword(word)) {
+                words << word;
+            }
+            start = -1;
+        }
+    }
+    return words;
+}
+
+bool PortageTextIndex::load()
+{
+    m_docs.clear();
+    m_repoStamps.clear();
+    m_terms.clear();
+    m_termIds.clear();
+
+    QFile file(cacheFilePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "PortageTextIndex: No index at" << file.fileName();
+        rebuildPostings();
+        return false;
+    }
+
+    if (!parse(file.readAll())) {
+        m_docs.clear();
+        m_repoStamps.clear();
+        m_terms.clear();
+        m_termIds.clear();
+        rebuildPostings();
+        return false;
+    }
+
+    for (quint32 termId = 0; termId < quint32(m_terms.size()); ++termId) {
+        m_termIds.insert(m_terms.at(termId), termId);
+    }
+    rebuildPostings();
+
+    qDebug() << "PortageTextIndex: Loaded" << m_docs.size() << "documents and" << m_terms.size() << "terms";
+    return true;
+}
+
+bool PortageTextIndex::parse(const QByteArray &data)
+{
+    if (data.size() < HEADER_SIZE) {
+        qDebug() << "PortageTextIndex: Index is truncated";
+        return false;
+    }
+
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_6_5);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint32 payloadSize = 0;
+    quint16 checksum = 0;
+    in >> magic >> version >> payloadSize >> checksum;
+
+    if (magic != MAGIC || version != FORMAT_VERSION) {
+        qDebug() << "PortageTextIndex: Index format mismatch, version" << version;
+        return false;
+    }
+
+    if (qint64(payloadSize) != data.size() - HEADER_SIZE
+        || qChecksum(QByteArrayView(data.constData() + HEADER_SIZE, payloadSize)) != checksum) {
+        qDebug() << "PortageTextIndex: Index is corrupt";
+        return false;
+    }
+
+    in >> m_repoStamps >> m_terms;
+
+    quint32 docCount = 0;
+    in >> docCount;
+    m_docs.reserve(docCount);
+    for (quint32 i = 0; i < docCount && in.status() == QDataStream::Ok; ++i) {
+        Document doc;
+        quint32 termCount = 0;
+        in >> doc.atom >> doc.repository >> doc.stamp >> doc.length >> termCount;
+        doc.terms.reserve(termCount);
+        for (quint32 j = 0; j < termCount && in.status() == QDataStream::Ok; ++j) {
+            quint32 termId = 0;
+            quint16 frequency = 0;
+            in >> termId >> frequency;
+            if (termId >= quint32(m_terms.size())) {
+                qDebug() << "PortageTextIndex: Index refers to an unknown term";
+                return false;
+            }
+            doc.terms.append(qMakePair(termId, frequency));
+        }
+        m_docs.append(doc);
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        qDebug() << "PortageTextIndex: Index ended unexpectedly";
+        return false;
+    }
+    return true;
+}
+
+bool PortageTextIndex::save() const
+{
+    QByteArray payload;
+    {
+        QDataStream out(&payload, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_6_5);
+
+        out << m_repoStamps << m_terms;
+        out << quint32(m_docs.size());
+        for (const Document &doc : m_docs) {
+            out << doc.atom << doc.repository << doc.stamp << doc.length << quint32(doc.terms.size());
+            for (const auto &term : doc.terms) {
+                out << term.first << term.second;
+            }
+        }
+    }
+
+    const QString path = cacheFilePath();
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+        qWarning() << "PortageTextIndex: Could not create cache directory for" << path;
+        return false;
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "PortageTextIndex: Could not open" << path << "for writing:" << file.errorString();
+        return false;
+    }
+
+    QDataStream header(&file);
+    header.setVersion(QDataStream::Qt_6_5);
+    header << MAGIC << FORMAT_VERSION << quint32(payload.size()) << qChecksum(QByteArrayView(payload));
+    file.write(payload);
+
+    if (!file.commit()) {
+        qWarning() << "PortageTextIndex: Failed to write" << path << ":" << file.errorString();
+        return false;
+    }
+
+    qDebug() << "PortageTextIndex: Saved index," << payload.size() << "bytes";
+    return true;
+}
+
+bool PortageTextIndex::update(const QList<QPair<QString, QString>> &repositories)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QHash<QString, QString> locations; // repositoryKey() -> location
+    for (const auto &repo : repositories) {
+        locations.insert(PortageCatalogCache::repositoryKey(repo.first, repo.second), repo.second);
+    }
+
+    // Repositories that were removed, or whose tree changed since the last update
+    QSet<QString> stale;
+    for (auto it = m_repoStamps.constBegin(); it != m_repoStamps.constEnd(); ++it) {
+        if (!locations.contains(it.key())) {
+            stale.insert(it.key());
+        }
+    }
+    QHash<QString, qint64> changedStamps;
+    for (auto it = locations.constBegin(); it != locations.constEnd(); ++it) {
+        const qint64 stamp = PortageCatalogCache::repositoryStamp(it.value());
+        if (!m_repoStamps.contains(it.key()) || m_repoStamps.value(it.key()) != stamp) {
+            changedStamps.insert(it.key(), stamp);
+        }
+    }
+
+    if (stale.isEmpty() && changedStamps.isEmpty()) {
+        return false;
+    }
+
+    int reread = 0;
+    QList<Document> docs;
+    docs.reserve(m_docs.size());
+    for (const Document &doc : std::as_const(m_docs)) {
+        if (!stale.contains(doc.repository) && !changedStamps.contains(doc.repository)) {
+            docs.append(doc);
+        }
+    }
+
+    for (auto it = changedStamps.constBegin(); it != changedStamps.constEnd(); ++it) {
+        const QString &key = it.key();
+        const QString location = locations.value(key);
+
+        // Documents of this repository, unchanged packages keep theirs
+        QHash<QString, qint64> knownStamps;
+        QHash<QString, qsizetype> previous;
+        for (qsizetype i = 0; i < m_docs.size(); ++i) {
+            if (m_docs.at(i).repository == key) {
+                knownStamps.insert(m_docs.at(i).atom, m_docs.at(i).stamp);
+                previous.insert(m_docs.at(i).atom, i);
+            }
+        }
+
+        const int repoFd = FsUtils::openDirectory(location);
+        if (repoFd < 0) {
+            qDebug() << "PortageTextIndex: Could not open repository" << location;
+            continue;
+        }
+
+        QList<CategoryJob> jobs;
+        const QStringList categories = PortageRepositoryReader::readCategories(location, repoFd);
+        for (const QString &category : categories) {
+            jobs << CategoryJob{location, repoFd, category, &knownStamps};
+        }
+
+        const QList<QList<ScannedPackage>> scanned =
+            QtConcurrent::blockingMapped<QList<QList<ScannedPackage>>>(jobs, &PortageTextIndex::scanCategory);
+        ::close(repoFd);
+
+        // Terms are interned here, the workers only return words
+        for (const QList<ScannedPackage> &packages : scanned) {
+            for (const ScannedPackage &pkg : packages) {
+                if (pkg.unchanged) {
+                    docs.append(m_docs.at(previous.value(pkg.atom)));
+                    continue;
+                }
+
+                Document doc;
+                doc.atom = pkg.atom;
+                doc.repository = key;
+                doc.stamp = pkg.stamp;
+                doc.length = pkg.length;
+                doc.terms.reserve(pkg.terms.size());
+                for (auto term = pkg.terms.constBegin(); term != pkg.terms.constEnd(); ++term) {
+                    doc.terms.append(qMakePair(internTerm(term.key()), term.value()));
+                }
+                docs.append(doc);
+                ++reread;
+            }
+        }
+        m_repoStamps.insert(key, it.value());
+    }
+
+    for (const QString &key : std::as_const(stale)) {
+        m_repoStamps.remove(key);
+    }
+
+    m_docs = docs;
+    compactTerms();
+    rebuildPostings();
+
+    qDebug() << "PortageTextIndex: Updated" << changedStamps.size() << "repositories," << reread
+             << "packages read," << m_docs.size() << "documents," << m_terms.size() << "terms in"
+             << timer.elapsed() << "ms";
+    return true;
+}
+
+QList<PortageTextIndex::ScannedPackage> PortageTextIndex::scanCategory(const CategoryJob &job)
+{
+    QList<ScannedPackage> result;
+
+    const int catFd = FsUtils::openDirectoryAt(job.repoFd, job.category);
+    if (catFd < 0) {
+        return result;
+    }
+
+    const QStringList packages = FsUtils::listDirectory(catFd, FsUtils::EntryType::Directories);
+    result.reserve(packages.size());
+    for (const QString &pkg : packages) {
+        struct stat st;
+        if (::fstatat(catFd, QFile::encodeName(pkg).constData(), &st, 0) != 0) {
+            continue;
+        }
+
+        ScannedPackage scanned;
+        scanned.atom = job.category + QLatin1Char('/') + pkg;
+        scanned.stamp = qint64(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+
+        // Syncs replace files by renaming, which bumps the package directory
+        if (job.knownStamps->value(scanned.atom, -1) == scanned.stamp) {
+            scanned.unchanged = true;
+            result << scanned;
+            continue;
+        }
+
+        const QStringList words = tokenize(packageText(job.repoPath, scanned.atom));
+        if (words.isEmpty()) {
+            continue;
+        }
+        scanned.length = quint32(words.size());
+        for (const QString &word : words) {
+            quint16 &frequency = scanned.terms[word];
+            if (frequency < std::numeric_limits<quint16>::max()) {
+                ++frequency;
+            }
+        }
+        result << scanned;
+    }
+
+    ::close(catFd);
+    return result;
+}
+
+QString PortageTextIndex::packageText(const QString &repoPath, const QString &atom)
+{
+    const QString pkgName = AtomParser::extractPackageName(atom);
+    const QString pkgPath = repoPath + QLatin1Char('/') + atom;
+
+    QStringList parts;
+    parts << pkgName;
+
+    const QStringList versions = PortageRepositoryReader::findAvailableVersions(pkgPath, pkgName);
+    if (!versions.isEmpty()) {
+        parts << PortageMetadataCache::loadVersion(repoPath, atom, versions.first()).description;
+    }
+
+    // Not through the shared cache, indexing would only evict what the UI needs
+    const MetadataXmlRecord record = PortageMetadataXml::parseFile(pkgPath + QStringLiteral("/metadata.xml"));
+    parts << record.longDescription;
+    parts << record.flagDescriptions.values();
+    return parts.join(QLatin1Char(' '));
+}
+
+quint32 PortageTextIndex::internTerm(const QString &term)
+{
+    const auto it = m_termIds.constFind(term);
+    if (it != m_termIds.constEnd()) {
+        return it.value();
+    }
+    const quint32 termId = quint32(m_terms.size());
+    m_terms << term;
+    m_termIds.insert(term, termId);
+    return termId;
+}
+
+void PortageTextIndex::compactTerms()
+{
+    // Drop terms no document uses any more, they pile up over many syncs
+    QList<quint32> remap(m_terms.size(), std::numeric_limits<quint32>::max());
+    QStringList terms;
+    for (Document &doc : m_docs) {
+        for (auto &term : doc.terms) {
+            quint32 &newId = remap[term.first];
+            if (newId == std::numeric_limits<quint32>::max()) {
+                newId = quint32(terms.size());
+                terms << m_terms.at(term.first);
+            }
+            term.first = newId;
+        }
+    }
+
+    m_terms = terms;
+    m_termIds.clear();
+    m_termIds.reserve(m_terms.size());
+    for (quint32 termId = 0; termId < quint32(m_terms.size()); ++termId) {
+        m_termIds.insert(m_terms.at(termId), termId);
+    }
+}
+
+void PortageTextIndex::rebuildPostings()
+{
+    m_postings = QList<QList<Posting>>(m_terms.size());
+
+    quint64 totalLength = 0;
+    for (quint32 docId = 0; docId < quint32(m_docs.size()); ++docId) {
+        const Document &doc = m_docs.at(docId);
+        totalLength += doc.length;
+        for (const auto &term : doc.terms) {
+            m_postings[term.first].append(Posting{docId, term.second});
+        }
+    }
+    m_averageLength = m_docs.isEmpty() ? 0 : float(totalLength) / float(m_docs.size());
+
+    m_sortedTerms.resize(m_terms.size());
+    std::iota(m_sortedTerms.begin(), m_sortedTerms.end(), 0);
+    std::sort(m_sortedTerms.begin(), m_sortedTerms.end(), [this](quint32 a, quint32 b) {
+        return m_terms.at(a) < m_terms.at(b);
+    });
+}
+
+QList<PortageTextIndex::Hit> PortageTextIndex::search(const QString &query, int limit) const
+{
+    QStringList words = tokenize(query);
+    words.removeDuplicates();
+    if (words.isEmpty() || m_docs.isEmpty()) {
+        return {};
+    }
+    // One bit per word in the match mask
+    if (words.size() > 32) {
+        words.resize(32);
+    }
+
+    struct Score {
+        float score = 0;
+        quint32 mask = 0;
+    };
+    QHash<quint32, Score> scores;
+
+    const float docCount = float(m_docs.size());
+    for (int i = 0; i < words.size(); ++i) {
+        const QString &word = words.at(i);
+
+        // The last word is probably still being typed
+        QList<quint32> termIds;
+        if (i == words.size() - 1) {
+            auto it = std::lower_bound(m_sortedTerms.cbegin(), m_sortedTerms.cend(), word, [this](quint32 termId, const QString &w) {
+                return m_terms.at(termId) < w;
+            });
+            for (; it != m_sortedTerms.cend() && termIds.size() < MAX_PREFIX_TERMS && m_terms.at(*it).startsWith(word); ++it) {
+                termIds << *it;
+            }
+        } else if (m_termIds.contains(word)) {
+            termIds << m_termIds.value(word);
+        }
+
+        for (quint32 termId : std::as_const(termIds)) {
+            const QList<Posting> &postings = m_postings.at(termId);
+            const float df = float(postings.size());
+            const float idf = std::log(1.0f + (docCount - df + 0.5f) / (df + 0.5f));
+            for (const Posting &posting : postings) {
+                const float tf = posting.frequency;
+                const float norm = K1 * (1.0f - B + B * float(m_docs.at(posting.doc).length) / m_averageLength);
+                Score &score = scores[posting.doc];
+                score.score += idf * tf * (K1 + 1.0f) / (tf + norm);
+                score.mask |= 1u << i;
+            }
+        }
+    }
+
+    // Documents containing every word, or anything that matched if none does
+    const quint32 allWords = words.size() == 32 ? std::numeric_limits<quint32>::max() : (1u << words.size()) - 1;
+    bool anyComplete = false;
+    for (const Score &score : std::as_const(scores)) {
+        if (score.mask == allWords) {
+            anyComplete = true;
+            break;
+        }
+    }
+
+    // An atom provided by several repositories counts once, with its best document
+    QHash<QString, float> best;
+    for (auto it = scores.constBegin(); it != scores.constEnd(); ++it) {
+        if (anyComplete && it.value().mask != allWords) {
+            continue;
+        }
+        float &score = best[m_docs.at(it.key()).atom];
+        score = qMax(score, it.value().score);
+    }
+
+    QList<Hit> hits;
+    hits.reserve(best.size());
+    for (auto it = best.constBegin(); it != best.constEnd(); ++it) {
+        hits.append(Hit{it.key(), it.value()});
+    }
+    std::sort(hits.begin(), hits.end(), [](const Hit &a, const Hit &b) {
+        return a.score > b.score || (a.score == b.score && a.atom < b.atom);
+    });
+    if (hits.size() > limit) {
+        hits.resize(limit);
+    }
+    return hits;
+}
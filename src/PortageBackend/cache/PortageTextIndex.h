@@ -0,0 +1,105 @@
+/*
+ * SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief Persistent full-text index over package descriptions
+ *
+ * One document per repository package, made of the package name, the
+ * DESCRIPTION of its newest ebuild, the metadata.xml longdescription and
+ * the USE flag descriptions. Queries are ranked with BM25 and only touch
+ * the in-memory postings, never the repository tree.
+ *
+ * The index is stored in the generic cache location and brought up to date
+ * incrementally: repositories whose stamp didn't change are kept as they
+ * are, inside a changed repository only packages whose directory mtime
+ * moved are read again. It is a plain value, updates are meant to run on
+ * a copy in a worker thread.
+ */
+class PortageTextIndex
+{
+public:
+    struct Hit {
+        QString atom;
+        float score = 0;
+    };
+
+    // Load the saved index, returns false if missing or corrupt
+    bool load();
+    bool save() const;
+
+    // Sync with the configured repositories (name, location), returns true if anything changed
+    bool update(const QList<QPair<QString, QString>> &repositories);
+
+    // Best matching atoms, highest score first; the last query word also matches as a prefix
+    QList<Hit> search(const QString &query, int limit = 200) const;
+
+    int documentCount() const { return m_docs.size(); }
+    int termCount() const { return m_terms.size(); }
+
+    static QString cacheFilePath();
+
+    // Case-folded words of at least two letters or digits, stopwords dropped
+    static QStringList tokenize(QStringView text);
+
+private:
+    struct Document {
+        QString atom;
+        QString repository; // PortageCatalogCache::repositoryKey()
+        qint64 stamp = 0;   // package directory mtime in ns
+        quint32 length = 0; // number of words
+        QList<QPair<quint32, quint16>> terms; // term id, frequency
+    };
+
+    struct Posting {
+        quint32 doc;
+        quint16 frequency;
+    };
+
+    struct CategoryJob {
+        QString repoPath;
+        int repoFd;
+        QString category;
+        const QHash<QString, qint64> *knownStamps; // atom -> stamp of the current document
+    };
+
+    struct ScannedPackage {
+        QString atom;
+        qint64 stamp = 0;
+        bool unchanged = false;
+        quint32 length = 0;
+        QHash<QString, quint16> terms;
+    };
+
+    bool parse(const QByteArray &data);
+    void compactTerms();
+    void rebuildPostings();
+    quint32 internTerm(const QString &term);
+
+    static QList<ScannedPackage> scanCategory(const CategoryJob &job);
+    static QString packageText(const QString &repoPath, const QString &atom);
+
+    static constexpr quint32 MAGIC = 0x50545849; // "PTXI"
+    static constexpr quint32 FORMAT_VERSION = 1;
+    static constexpr int HEADER_SIZE = 14; // magic + version + payload size + checksum
+    static constexpr int MAX_PREFIX_TERMS = 50;
+
+    QList<Document> m_docs;
+    QHash<QString, qint64> m_repoStamps; // repositoryKey() -> PortageCatalogCache::repositoryStamp()
+    QStringList m_terms;
+    QHash<QString, quint32> m_termIds;
+
+    // Derived on load and update, not saved
+    QList<QList<Posting>> m_postings; // by term id
+    QList<quint32> m_sortedTerms;     // term ids in term order, for prefix lookups
+    float m_averageLength = 0;
+};
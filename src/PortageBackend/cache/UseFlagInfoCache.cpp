@@ -0,0 +1,105 @@
+/*
+ * SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include "UseFlagInfoCache.h"
+#include "../config/PortageConfigIndex.h"
+
+#include <QDebug>
+#include <QSet>
+
+UseFlagInfoCache &UseFlagInfoCache::instance()
+{
+    static UseFlagInfoCache inst;
+    return inst;
+}
+
+UseFlagInfoCache::UseFlagInfoCache()
+    : m_cache(MAX_RECORDS)
+{
+}
+
+QString UseFlagInfoCache::key(const QString &atom, const QString &version, const QString &repository)
+{
+    return repository + QLatin1Char('|') + atom + QLatin1Char('|') + version;
+}
+
+std::optional<UseFlagInfo> UseFlagInfoCache::find(const QString &atom, const QString &version, const QString &repository,
+                                                  quint64 &epoch)
+{
+    // Re-reads package.use first if it changed on disk
+    const quint64 generation = PortageConfigIndex::instance().generation(PortageConfigIndex::PackageUse);
+
+    QMutexLocker locker(&m_lock);
+    if (generation != m_configGeneration) {
+        if (!m_cache.isEmpty()) {
+            qDebug() << "UseFlagInfoCache: package.use changed, dropping" << m_cache.size() << "records -" << hits()
+                     << "hits," << misses() << "misses so far";
+        }
+        m_cache.clear();
+        m_configGeneration = generation;
+        ++m_epoch;
+    }
+    epoch = m_epoch;
+
+    const UseFlagInfo *info = m_cache.object(key(atom, version, repository));
+    if (!info) {
+        m_misses.fetchAndAddRelaxed(1);
+        return std::nullopt;
+    }
+    m_hits.fetchAndAddRelaxed(1);
+    return *info;
+}
+
+void UseFlagInfoCache::insert(const QString &atom, const QString &version, const QString &repository,
+                              const UseFlagInfo &info, quint64 epoch)
+{
+    const quint64 generation = PortageConfigIndex::instance().generation(PortageConfigIndex::PackageUse);
+
+    QMutexLocker locker(&m_lock);
+    // Read before an invalidation (or a package.use change find() hasn't seen yet): possibly stale
+    if (epoch != m_epoch || generation != m_configGeneration) {
+        return;
+    }
+    m_cache.insert(key(atom, version, repository), new UseFlagInfo(info));
+}
+
+void UseFlagInfoCache::invalidateInstalled(const QStringList &categories)
+{
+    QMutexLocker locker(&m_lock);
+    ++m_epoch;
+
+    const QSet<QString> changed(categories.cbegin(), categories.cend());
+    int dropped = 0;
+    const QStringList keys = m_cache.keys();
+    for (const QString &cacheKey : keys) {
+        // Installed records have an empty repository part: "|category/package|version"
+        if (cacheKey.startsWith(QLatin1Char('|'))
+            && changed.contains(cacheKey.section(QLatin1Char('|'), 1, 1).section(QLatin1Char('/'), 0, 0))) {
+            m_cache.remove(cacheKey);
+            ++dropped;
+        }
+    }
+
+    qDebug() << "UseFlagInfoCache: Dropped" << dropped << "installed records in" << categories << "-" << hits()
+             << "hits," << misses() << "misses so far";
+}
+
+void UseFlagInfoCache::invalidateRepository(const QString &repository)
+{
+    if (repository.isEmpty()) {
+        return;
+    }
+
+    QMutexLocker locker(&m_lock);
+    ++m_epoch;
+
+    const QString prefix = repository + QLatin1Char('|');
+    const QStringList keys = m_cache.keys();
+    for (const QString &cacheKey : keys) {
+        if (cacheKey.startsWith(prefix)) {
+            m_cache.remove(cacheKey);
+        }
+    }
+}
@@ -0,0 +1,66 @@
+/*
+ * SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#pragma once
+
+#include <QAtomicInteger>
+#include <QCache>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+#include <optional>
+
+#include "../resources/PortageUseFlags.h"
+
+/**
+ * @brief Process-wide cache of UseFlagInfo records
+ *
+ * Installed records (read from /var/db/pkg) and repository records (IUSE
+ * from the metadata cache plus metadata.xml descriptions) are kept in one
+ * bounded LRU cache keyed by (atom, version, repository), so every
+ * short-lived PortageUseFlags shares them. Installed records of a
+ * category are dropped when the vdb watcher reports it, repository
+ * records when their repository is reloaded, and everything when
+ * package.use is read again by PortageConfigIndex. Every invalidation
+ * bumps an epoch; a record read after a miss is only inserted if no
+ * invalidation happened since find() reported the miss. Hit and miss
+ * counters are lock-free. Thread-safe.
+ */
+class UseFlagInfoCache
+{
+public:
+    static UseFlagInfoCache &instance();
+
+    // repository is empty for installed records, the repository location otherwise.
+    // epoch receives the cache epoch to pass to insert() after a miss.
+    std::optional<UseFlagInfo> find(const QString &atom, const QString &version, const QString &repository,
+                                    quint64 &epoch);
+    // Dropped if an invalidation happened since the find() that returned epoch
+    void insert(const QString &atom, const QString &version, const QString &repository, const UseFlagInfo &info,
+                quint64 epoch);
+
+    // Installed packages in these categories changed
+    void invalidateInstalled(const QStringList &categories);
+    // A repository was synced, added or removed
+    void invalidateRepository(const QString &repository);
+
+    quint64 hits() const { return m_hits.loadRelaxed(); }
+    quint64 misses() const { return m_misses.loadRelaxed(); }
+
+private:
+    UseFlagInfoCache();
+
+    static QString key(const QString &atom, const QString &version, const QString &repository);
+
+    static constexpr int MAX_RECORDS = 4000;
+
+    QCache<QString, UseFlagInfo> m_cache;
+    quint64 m_configGeneration = 0; // PortageConfigIndex::generation(PackageUse) the records belong to
+    quint64 m_epoch = 0;            // bumped by every invalidation
+    QMutex m_lock;
+    QAtomicInteger<quint64> m_hits;
+    QAtomicInteger<quint64> m_misses;
+};
@@ -0,0 +1,374 @@
+/*
+ *   SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include "MakeConfEvaluator.h"
+#include "../utils/FsUtils.h"
+#include "../utils/PortagePaths.h"
+
+#include <QDeadlineTimer>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+
+namespace
+{
+// Used when make.conf doesn't set USE_EXPAND itself (it normally comes from the profile)
+const char *const defaultUseExpand[] = {
+    "ABI_X86",       "CPU_FLAGS_X86",   "GRUB_PLATFORMS",     "INPUT_DEVICES", "L10N",
+    "LLVM_TARGETS",  "LUA_SINGLE_TARGET", "LUA_TARGETS",      "PHP_TARGETS",   "PYTHON_SINGLE_TARGET",
+    "PYTHON_TARGETS", "RUBY_TARGETS",   "VIDEO_CARDS",
+};
+
+bool isNameStart(QChar c)
+{
+    return c == QLatin1Char('_') || (c.unicode() < 128 && c.isLetter());
+}
+
+bool isNameChar(QChar c)
+{
+    return isNameStart(c) || (c.unicode() < 128 && c.isDigit());
+}
+
+bool isBlank(QChar c)
+{
+    return c == QLatin1Char(' ') || c == QLatin1Char('\t') || c == QLatin1Char('\r');
+}
+
+/**
+ * The shell subset Portage accepts in make.conf, one statement at a time
+ */
+class Lexer
+{
+public:
+    Lexer(QStringView text, const MakeConfEvaluator::Variables &variables)
+        : m_text(text)
+        , m_variables(variables)
+    {
+    }
+
+    bool atEnd() const { return m_pos >= m_text.size(); }
+    QChar peek(qsizetype offset = 0) const
+    {
+        return m_pos + offset < m_text.size() ? m_text.at(m_pos + offset) : QChar();
+    }
+    void advance(qsizetype count = 1) { m_pos += count; }
+
+    void skipBlanks(bool newlines)
+    {
+        while (!atEnd()) {
+            const QChar c = peek();
+            if (isBlank(c) || (newlines && c == QLatin1Char('\n'))) {
+                advance();
+            } else if (c == QLatin1Char('\\') && peek(1) == QLatin1Char('\n')) {
+                advance(2);
+            } else {
+                break;
+            }
+        }
+    }
+
+    void skipLine()
+    {
+        while (!atEnd() && peek() != QLatin1Char('\n')) {
+            advance();
+        }
+    }
+
+    QString readName()
+    {
+        if (!isNameStart(peek())) {
+            return QString();
+        }
+        const qsizetype start = m_pos;
+        while (isNameChar(peek())) {
+            advance();
+        }
+        return m_text.sliced(start, m_pos - start).toString();
+    }
+
+    // One shell word: quoting removed, variables expanded
+    QString readWord()
+    {
+        QString word;
+        while (!atEnd()) {
+            const QChar c = peek();
+            if (isBlank(c) || c == QLatin1Char('\n')) {
+                break;
+            }
+            if (c == QLatin1Char('\\')) {
+                // Continuation, or an escaped character
+                if (peek(1) != QLatin1Char('\n') && m_pos + 1 < m_text.size()) {
+                    word += peek(1);
+                }
+                advance(2);
+            } else if (c == QLatin1Char('\'')) {
+                advance();
+                qsizetype end = m_text.indexOf(QLatin1Char('\''), m_pos);
+                if (end < 0) {
+                    end = m_text.size();
+                }
+                word += m_text.sliced(m_pos, end - m_pos);
+                m_pos = end + 1;
+            } else if (c == QLatin1Char('"')) {
+                advance();
+                readDoubleQuoted(word);
+            } else if (c == QLatin1Char('$')) {
+                word += expand();
+            } else {
+                word += c;
+                advance();
+            }
+        }
+        return word;
+    }
+
+private:
+    void readDoubleQuoted(QString &word)
+    {
+        while (!atEnd() && peek() != QLatin1Char('"')) {
+            const QChar c = peek();
+            if (c == QLatin1Char('\\') && m_pos + 1 < m_text.size()) {
+                const QChar next = peek(1);
+                if (next == QLatin1Char('\n')) {
+                    advance(2);
+                    continue;
+                }
+                if (next == QLatin1Char('"') || next == QLatin1Char('\\') || next == QLatin1Char('$')
+                    || next == QLatin1Char('`')) {
+                    word += next;
+                    advance(2);
+                    continue;
+                }
+                word += c;
+                advance();
+            } else if (c == QLatin1Char('$')) {
+                word += expand();
+            } else {
+                word += c;
+                advance();
+            }
+        }
+        advance(); // closing quote
+    }
+
+    // At a '$': ${VAR}, ${VAR:-default}, ${VAR-default} or $VAR
+    QString expand()
+    {
+        advance();
+        if (peek() == QLatin1Char('{')) {
+            advance();
+            qsizetype end = m_text.indexOf(QLatin1Char('}'), m_pos);
+            if (end < 0) {
+                end = m_text.size();
+            }
+            const QStringView inner = m_text.sliced(m_pos, end - m_pos);
+            m_pos = end + 1;
+
+            qsizetype nameLength = 0;
+            while (nameLength < inner.size() && isNameChar(inner.at(nameLength))) {
+                ++nameLength;
+            }
+            const QString name = inner.first(nameLength).toString();
+            const QStringView rest = inner.sliced(nameLength);
+            const auto it = m_variables.constFind(name);
+            if (rest.startsWith(u":-")) {
+                return it != m_variables.constEnd() && !it->isEmpty() ? it.value() : rest.sliced(2).toString();
+            }
+            if (rest.startsWith(u"-")) {
+                return it != m_variables.constEnd() ? it.value() : rest.sliced(1).toString();
+            }
+            return it != m_variables.constEnd() ? it.value() : QString();
+        }
+
+        const QString name = readName();
+        if (name.isEmpty()) {
+            return QStringLiteral("$");
+        }
+        return m_variables.value(name);
+    }
+
+    QStringView m_text;
+    qsizetype m_pos = 0;
+    const MakeConfEvaluator::Variables &m_variables;
+};
+}
+
+MakeConfEvaluator &MakeConfEvaluator::instance()
+{
+    static MakeConfEvaluator inst;
+    return inst;
+}
+
+MakeConfEvaluator::MakeConfEvaluator()
+{
+}
+
+void MakeConfEvaluator::evaluate(const QString &path, Variables &variables, QHash<QString, qint64> &stamps)
+{
+    evaluateFile(path, variables, stamps, 0);
+}
+
+void MakeConfEvaluator::evaluateFile(const QString &path, Variables &variables, QHash<QString, qint64> &stamps, int depth)
+{
+    stamps.insert(path, FsUtils::modificationTime(path));
+
+    const QFileInfo info(path);
+    if (info.isDir()) {
+        // make.conf/ holds files that are read one after the other, in name order
+        const QFileInfoList entries = QDir(path).entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+        for (const QFileInfo &entry : entries) {
+            if (entry.fileName().startsWith(QLatin1Char('.')) || entry.fileName().endsWith(QLatin1Char('~'))) {
+                continue;
+            }
+            evaluateFile(entry.filePath(), variables, stamps, depth);
+        }
+        return;
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    const QString text = QString::fromUtf8(file.readAll());
+    evaluateText(text, info.absolutePath(), variables, stamps, depth);
+}
+
+void MakeConfEvaluator::evaluateText(QStringView text, const QString &baseDir, Variables &variables,
+                                     QHash<QString, qint64> &stamps, int depth)
+{
+    Lexer lexer(text, variables);
+    while (true) {
+        lexer.skipBlanks(true);
+        if (lexer.atEnd()) {
+            break;
+        }
+        if (lexer.peek() == QLatin1Char('#')) {
+            lexer.skipLine();
+            continue;
+        }
+
+        QString name;
+        const bool dotSource = lexer.peek() == QLatin1Char('.') && isBlank(lexer.peek(1));
+        if (dotSource) {
+            lexer.advance();
+        } else {
+            name = lexer.readName();
+            if (name == QLatin1String("export")) {
+                lexer.skipBlanks(false);
+                name = lexer.readName();
+            }
+        }
+
+        if (dotSource || (name == QLatin1String("source") && isBlank(lexer.peek()))) {
+            lexer.skipBlanks(false);
+            QString sourced = lexer.readWord();
+            lexer.skipLine();
+            if (sourced.isEmpty() || depth >= MAX_SOURCE_DEPTH) {
+                continue;
+            }
+            if (QDir::isRelativePath(sourced)) {
+                sourced = baseDir + QLatin1Char('/') + sourced;
+            }
+            evaluateFile(sourced, variables, stamps, depth + 1);
+            continue;
+        }
+
+        bool append = false;
+        if (!name.isEmpty() && lexer.peek() == QLatin1Char('+') && lexer.peek(1) == QLatin1Char('=')) {
+            append = true;
+            lexer.advance(2);
+        } else if (!name.isEmpty() && lexer.peek() == QLatin1Char('=')) {
+            lexer.advance();
+        } else {
+            // Not an assignment, nothing else means anything in make.conf
+            lexer.skipLine();
+            continue;
+        }
+
+        const QString value = lexer.readWord();
+        if (append) {
+            variables[name] += value;
+        } else {
+            variables.insert(name, value);
+        }
+    }
+}
+
+void MakeConfEvaluator::refresh()
+{
+    const qint64 now = QDeadlineTimer::current().deadline();
+    if (m_loaded && now - m_checkedAt < RECHECK_INTERVAL_MS) {
+        return;
+    }
+    m_checkedAt = now;
+
+    if (m_loaded) {
+        bool changed = false;
+        for (auto it = m_stamps.constBegin(); it != m_stamps.constEnd() && !changed; ++it) {
+            changed = FsUtils::modificationTime(it.key()) != it.value();
+        }
+        if (!changed) {
+            return;
+        }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    Variables variables;
+    QHash<QString, qint64> stamps;
+    evaluate(QLatin1String(PortagePaths::MAKE_CONF), variables, stamps);
+    m_variables = variables;
+    m_stamps = stamps;
+    m_loaded = true;
+
+    qDebug() << "MakeConfEvaluator: Evaluated" << m_variables.size() << "variables from" << m_stamps.size()
+             << "paths in" << timer.elapsed() << "ms";
+}
+
+QString MakeConfEvaluator::value(const QString &name)
+{
+    QMutexLocker locker(&m_lock);
+    refresh();
+    return m_variables.value(name);
+}
+
+MakeConfEvaluator::Variables MakeConfEvaluator::variables()
+{
+    QMutexLocker locker(&m_lock);
+    refresh();
+    return m_variables;
+}
+
+QHash<QString, QStringList> MakeConfEvaluator::useExpandFlags()
+{
+    const Variables vars = variables();
+
+    QStringList names = vars.value(QStringLiteral("USE_EXPAND")).split(QLatin1Char(' '), Qt::SkipEmptyParts);
+    if (names.isEmpty()) {
+        for (const char *name : defaultUseExpand) {
+            names << QLatin1String(name);
+        }
+    }
+
+    QHash<QString, QStringList> result;
+    for (const QString &name : std::as_const(names)) {
+        const auto it = vars.constFind(name);
+        if (it == vars.constEnd()) {
+            continue;
+        }
+        const QString prefix = name.toLower() + QLatin1Char('_');
+        QStringList &flags = result[prefix];
+        const QStringList values = it->simplified().split(QLatin1Char(' '), Qt::SkipEmptyParts);
+        for (const QString &value : values) {
+            // "-*" and negations only make sense against profile defaults
+            if (!value.startsWith(QLatin1Char('-'))) {
+                flags << prefix + value;
+            }
+        }
+    }
+    return result;
+}
@@ -0,0 +1,61 @@
+/*
+ *   SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief Process-wide variable table of /etc/portage/make.conf
+ *
+ * make.conf (a file, or a directory of files read in name order) is
+ * evaluated once, the way Portage's own parser reads it: single and double
+ * quotes, backslash continuations, ${VAR} / $VAR / ${VAR:-default}
+ * expansion, += appends, "export" and "source" / "." of other files.
+ * Lookups are hash probes afterwards. Every file and directory that was
+ * read is stamped with its mtime and the table is evaluated again once
+ * any of them changes; stamps are compared at most once a second.
+ * Thread-safe.
+ */
+class MakeConfEvaluator
+{
+public:
+    using Variables = QHash<QString, QString>;
+
+    static MakeConfEvaluator &instance();
+
+    // Value after the whole configuration has been evaluated, empty if unset
+    QString value(const QString &name);
+    Variables variables();
+
+    // USE flags of the USE_EXPAND variables that are set, by prefix:
+    // VIDEO_CARDS="amdgpu radeonsi" -> "video_cards_" -> video_cards_amdgpu, video_cards_radeonsi
+    QHash<QString, QStringList> useExpandFlags();
+
+    // Evaluate a make.conf style file or directory on top of variables,
+    // the mtime of everything read is recorded in stamps (-1 if missing)
+    static void evaluate(const QString &path, Variables &variables, QHash<QString, qint64> &stamps);
+
+private:
+    MakeConfEvaluator();
+
+    void refresh();
+
+    static void evaluateFile(const QString &path, Variables &variables, QHash<QString, qint64> &stamps, int depth);
+    static void evaluateText(QStringView text, const QString &baseDir, Variables &variables,
+                             QHash<QString, qint64> &stamps, int depth);
+
+    static constexpr qint64 RECHECK_INTERVAL_MS = 1000;
+    static constexpr int MAX_SOURCE_DEPTH = 8;
+
+    Variables m_variables;
+    QHash<QString, qint64> m_stamps; // every path read -> mtime in ns
+    qint64 m_checkedAt = 0;
+    bool m_loaded = false;
+    QMutex m_lock;
+};
@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <QHash>
 #include <QObject>
 #include <QString>
 #include <QStringList>
@@ -16,17 +17,11 @@ public:
     
     QStringList readGlobalUseFlags() const;
     
-    QStringList readL10N() const;
+    // Flags of the USE_EXPAND variables set in make.conf by lowercase prefix ("l10n_", "video_cards_", ...)
+    QHash<QString, QStringList> readUseExpand() const;
     
     // Read global USE flags from package.use files (*/* use_flag)
     QStringList readGlobalPackageUse() const;
     
     QString readVariable(const QString &variableName) const;
-    
-private:
-    QString parseVariable(const QString &filePath, const QString &variableName) const;
-    void parsePackageUseFile(const QString &filePath, QStringList &globalFlags) const;
-    
-    static constexpr const char *MAKE_CONF_PATH = "/etc/portage/make.conf";
-    static constexpr const char *PACKAGE_USE_DIR = "/etc/portage/package.use";
 };
@@ -0,0 +1,175 @@
+/*
+ *   SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include "PortageConfigIndex.h"
+#include "../utils/FsUtils.h"
+#include "../utils/PortagePaths.h"
+
+#include <QDeadlineTimer>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+
+#include <algorithm>
+
+PortageConfigIndex &PortageConfigIndex::instance()
+{
+    static PortageConfigIndex inst;
+    return inst;
+}
+
+PortageConfigIndex::PortageConfigIndex()
+{
+}
+
+QString PortageConfigIndex::path(Kind kind)
+{
+    switch (kind) {
+    case PackageUse:
+        return QLatin1String(PortagePaths::PACKAGE_USE);
+    case PackageAcceptKeywords:
+        return QLatin1String(PortagePaths::PACKAGE_ACCEPT_KEYWORDS);
+    case PackageMask:
+        return QLatin1String(PortagePaths::PACKAGE_MASK);
+    case PackageUnmask:
+        return QLatin1String(PortagePaths::PACKAGE_UNMASK);
+    case PackageLicense:
+        return QLatin1String(PortagePaths::PACKAGE_LICENSE);
+    case KindCount:
+        break;
+    }
+    return QString();
+}
+
+QList<PortageConfigIndex::Entry> PortageConfigIndex::readEntries(const QString &path, QHash<QString, qint64> *stamps)
+{
+    QList<Entry> entries;
+    readPath(path, entries, stamps);
+    return entries;
+}
+
+void PortageConfigIndex::readPath(const QString &path, QList<Entry> &entries, QHash<QString, qint64> *stamps)
+{
+    if (stamps) {
+        stamps->insert(path, FsUtils::modificationTime(path));
+    }
+
+    const QFileInfo info(path);
+    if (info.isDir()) {
+        // Portage reads directories recursively in name order, skipping hidden and backup files
+        const QFileInfoList children = QDir(path).entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+        for (const QFileInfo &child : children) {
+            if (!child.fileName().startsWith(QLatin1Char('.')) && !child.fileName().endsWith(QLatin1Char('~'))) {
+                readPath(child.filePath(), entries, stamps);
+            }
+        }
+        return;
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return;
+    }
+
+    const QList<QByteArray> lines = file.readAll().split('\n');
+    for (qsizetype i = 0; i < lines.size(); ++i) {
+        const QByteArray &line = lines.at(i);
+        const qsizetype comment = line.indexOf('#');
+        const QByteArray content = (comment < 0 ? line : line.first(comment)).simplified();
+        if (content.isEmpty()) {
+            continue;
+        }
+
+        Entry entry;
+        entry.values = QString::fromUtf8(content).split(QLatin1Char(' '), Qt::SkipEmptyParts);
+        entry.atom = entry.values.takeFirst();
+        if (!entry.atom.startsWith(QLatin1Char('-'))) {
+            entry.spec = PortageAtomSpec::parse(entry.atom);
+        }
+        entry.file = path;
+        entry.line = int(i + 1);
+        entries << entry;
+    }
+}
+
+PortageConfigIndex::Table &PortageConfigIndex::table(Kind kind)
+{
+    Table &t = m_tables[kind];
+
+    const qint64 now = QDeadlineTimer::current().deadline();
+    if (t.loaded && now - t.checkedAt < RECHECK_INTERVAL_MS) {
+        return t;
+    }
+    t.checkedAt = now;
+
+    if (t.loaded) {
+        bool changed = false;
+        for (auto it = t.stamps.constBegin(); it != t.stamps.constEnd() && !changed; ++it) {
+            changed = FsUtils::modificationTime(it.key()) != it.value();
+        }
+        if (!changed) {
+            return t;
+        }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    t.entries.clear();
+    t.byAtom.clear();
+    t.stamps.clear();
+    readPath(path(kind), t.entries, &t.stamps);
+    for (qsizetype i = 0; i < t.entries.size(); ++i) {
+        const PortageAtomSpec &spec = t.entries.at(i).spec;
+        if (spec.isValid()) {
+            t.byAtom[spec.hasWildcard() ? QString() : spec.atom().toLower()] << i;
+        }
+    }
+    t.loaded = true;
+    ++t.generation;
+
+    qDebug() << "PortageConfigIndex: Read" << t.entries.size() << "entries from" << path(kind) << "in"
+             << timer.elapsed() << "ms";
+    return t;
+}
+
+QList<PortageConfigIndex::Entry> PortageConfigIndex::entries(Kind kind)
+{
+    QMutexLocker locker(&m_lock);
+    return table(kind).entries;
+}
+
+QList<PortageConfigIndex::Entry> PortageConfigIndex::entriesFor(Kind kind, const QString &atom)
+{
+    QMutexLocker locker(&m_lock);
+    const Table &t = table(kind);
+
+    QList<qsizetype> indexes = t.byAtom.value(atom.toLower());
+    indexes << t.byAtom.value(QString());
+    std::sort(indexes.begin(), indexes.end());
+
+    QList<Entry> result;
+    result.reserve(indexes.size());
+    for (qsizetype index : std::as_const(indexes)) {
+        result << t.entries.at(index);
+    }
+    return result;
+}
+
+quint64 PortageConfigIndex::generation(Kind kind)
+{
+    QMutexLocker locker(&m_lock);
+    return table(kind).generation;
+}
+
+void PortageConfigIndex::invalidate()
+{
+    QMutexLocker locker(&m_lock);
+    for (Table &t : m_tables) {
+        t.loaded = false;
+    }
+}
@@ -0,0 +1,88 @@
+/*
+ *   SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+#include <array>
+
+#include "../utils/PortageAtomSpec.h"
+
+/**
+ * @brief Parsed, atom-keyed view of the /etc/portage/package.* files
+ *
+ * package.use, package.accept_keywords, package.mask, package.unmask and
+ * package.license are each read once (a file, or a directory read
+ * recursively in name order) into entries that remember where they came
+ * from. Lookups by package are hash probes. Every file and directory read
+ * is stamped with its mtime; a kind is read again when one of its stamps
+ * moved (compared at most once a second) or after invalidate(), which
+ * writers call right after changing a file. Thread-safe.
+ */
+class PortageConfigIndex
+{
+public:
+    enum Kind {
+        PackageUse,
+        PackageAcceptKeywords,
+        PackageMask,
+        PackageUnmask,
+        PackageLicense,
+        KindCount,
+    };
+
+    struct Entry {
+        QString atom;       // first field as written, e.g. ">=dev-lang/python-3.12:3.12", "*/*" or "-app-misc/foo"
+        QStringList values; // remaining fields (flags, keywords, licenses)
+        PortageAtomSpec spec; // invalid for "-atom" removals and malformed lines
+        QString file;
+        int line = 0; // 1-based
+    };
+
+    static PortageConfigIndex &instance();
+
+    // All entries of a kind, in file order
+    QList<Entry> entries(Kind kind);
+
+    // Entries whose atom names this category/package, plus wildcard entries, in file order
+    QList<Entry> entriesFor(Kind kind, const QString &atom);
+
+    // Drop everything, the next lookup reads the files again
+    void invalidate();
+
+    // Bumped every time a kind is read again, lets dependent caches notice changes
+    quint64 generation(Kind kind);
+
+    static QString path(Kind kind);
+
+    // Entries of any package.*-style file or directory; the mtime of everything read goes to stamps
+    static QList<Entry> readEntries(const QString &path, QHash<QString, qint64> *stamps = nullptr);
+
+private:
+    PortageConfigIndex();
+
+    struct Table {
+        QList<Entry> entries;
+        QHash<QString, QList<qsizetype>> byAtom; // lowercase category/package ("" for wildcards) -> entry indexes
+        QHash<QString, qint64> stamps;
+        qint64 checkedAt = 0;
+        quint64 generation = 0;
+        bool loaded = false;
+    };
+
+    Table &table(Kind kind); // caller holds m_lock
+
+    static void readPath(const QString &path, QList<Entry> &entries, QHash<QString, qint64> *stamps);
+
+    static constexpr qint64 RECHECK_INTERVAL_MS = 1000;
+
+    std::array<Table, KindCount> m_tables;
+    QMutex m_lock;
+};
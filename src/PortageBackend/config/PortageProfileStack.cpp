@@ -0,0 +1,374 @@
+/*
+ *   SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include "PortageProfileStack.h"
+#include "MakeConfEvaluator.h"
+#include "../repository/PortageRepositoryConfig.h"
+#include "../utils/FsUtils.h"
+#include "../utils/PortagePaths.h"
+#include "../utils/UseFlagDictionary.h"
+
+#include <QDeadlineTimer>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+
+#include <algorithm>
+
+namespace
+{
+// Variables whose make.defaults / make.conf values accumulate instead of replacing each other
+const char *const incrementalVariables[] = {
+    "USE", "USE_EXPAND", "USE_EXPAND_HIDDEN", "USE_EXPAND_IMPLICIT", "USE_EXPAND_UNPREFIXED", "IUSE_IMPLICIT",
+    "ACCEPT_KEYWORDS", "FEATURES", "CONFIG_PROTECT", "CONFIG_PROTECT_MASK", "PROFILE_ONLY_VARIABLES", "ENV_UNSET",
+};
+
+bool isIncremental(const QString &name, const QHash<QString, QStringList> &stacked)
+{
+    for (const char *variable : incrementalVariables) {
+        if (name == QLatin1String(variable)) {
+            return true;
+        }
+    }
+    // Every USE_EXPAND variable stacks too (VIDEO_CARDS, PYTHON_TARGETS, ...)
+    return stacked.value(QStringLiteral("USE_EXPAND")).contains(name);
+}
+
+// use.force, use.mask and friends: one flag per line, "-flag" drops it again, "-*" drops all
+void stackFlags(UseFlagSet &flags, const QList<PortageConfigIndex::Entry> &entries)
+{
+    UseFlagDictionary &dict = UseFlagDictionary::instance();
+    for (const PortageConfigIndex::Entry &entry : entries) {
+        for (const QString &token : QStringList(entry.atom) + entry.values) {
+            if (token == QLatin1String("-*")) {
+                flags.clear();
+            } else if (token.startsWith(QLatin1Char('-'))) {
+                flags.remove(dict.find(token.mid(1)));
+            } else {
+                flags.insert(dict.intern(token));
+            }
+        }
+    }
+}
+}
+
+PortageProfileStack &PortageProfileStack::instance()
+{
+    static PortageProfileStack inst;
+    return inst;
+}
+
+PortageProfileStack::PortageProfileStack()
+{
+}
+
+void PortageProfileStack::resolveParents(const QString &path, QStringList &profiles, QHash<QString, qint64> &stamps, int depth)
+{
+    if (depth > MAX_PARENT_DEPTH || profiles.contains(path)) {
+        return;
+    }
+
+    const QString parentFile = path + QStringLiteral("/parent");
+    stamps.insert(parentFile, FsUtils::modificationTime(parentFile));
+
+    QFile file(parentFile);
+    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        const QList<QByteArray> lines = file.readAll().split('\n');
+        for (const QByteArray &rawLine : lines) {
+            const QString line = QString::fromUtf8(rawLine).trimmed();
+            if (line.isEmpty() || line.startsWith(QLatin1Char('#'))) {
+                continue;
+            }
+
+            // Parents are relative paths, absolute paths or "repository:path" below its profiles/
+            QString parent;
+            const qsizetype colon = line.indexOf(QLatin1Char(':'));
+            if (line.startsWith(QLatin1Char('/'))) {
+                parent = line;
+            } else if (colon > 0) {
+                const QString location = PortageRepositoryConfig::instance().getRepositoryLocation(line.left(colon));
+                if (location.isEmpty()) {
+                    qDebug() << "PortageProfileStack: Unknown repository in parent" << line << "of" << path;
+                    continue;
+                }
+                parent = location + QStringLiteral("/profiles/") + line.mid(colon + 1);
+            } else {
+                parent = path + QLatin1Char('/') + line;
+            }
+
+            const QString canonical = QFileInfo(QDir::cleanPath(parent)).canonicalFilePath();
+            if (canonical.isEmpty()) {
+                qDebug() << "PortageProfileStack: Missing parent profile" << parent << "of" << path;
+                continue;
+            }
+            resolveParents(canonical, profiles, stamps, depth + 1);
+        }
+    }
+
+    profiles << path;
+}
+
+void PortageProfileStack::addRules(PackageRules &rules, const QList<PortageConfigIndex::Entry> &entries, int &order)
+{
+    UseFlagDictionary &dict = UseFlagDictionary::instance();
+    for (const PortageConfigIndex::Entry &entry : entries) {
+        if (!entry.spec.isValid()) {
+            continue;
+        }
+        PackageRule rule;
+        rule.spec = entry.spec;
+        rule.order = order++;
+        for (const QString &flag : entry.values) {
+            if (flag.startsWith(QLatin1Char('-'))) {
+                rule.off.insert(dict.intern(flag.mid(1)));
+            } else {
+                rule.on.insert(dict.intern(flag));
+            }
+        }
+        rules[entry.spec.hasWildcard() ? QString() : entry.spec.atom().toLower()] << rule;
+    }
+}
+
+void PortageProfileStack::applyRules(const PackageRules &rules, const QString &atom, const QString &version,
+                                     const QString &slot, const QString &repository, UseFlagSet &flags)
+{
+    QList<const PackageRule *> matched;
+    for (const QString &key : {atom.toLower(), QString()}) {
+        const auto it = rules.constFind(key);
+        if (it == rules.constEnd()) {
+            continue;
+        }
+        for (const PackageRule &rule : it.value()) {
+            if (rule.spec.matches(atom, version, slot, repository)) {
+                matched << &rule;
+            }
+        }
+    }
+
+    std::sort(matched.begin(), matched.end(), [](const PackageRule *a, const PackageRule *b) {
+        return a->order < b->order;
+    });
+    for (const PackageRule *rule : std::as_const(matched)) {
+        flags |= rule->on;
+        flags.subtract(rule->off);
+    }
+}
+
+std::shared_ptr<PortageProfileStack::State> PortageProfileStack::build()
+{
+    auto state = std::make_shared<State>();
+
+    const QString makeProfile = QLatin1String(PortagePaths::MAKE_PROFILE);
+    state->profilePath = QFileInfo(makeProfile).canonicalFilePath();
+    if (!state->profilePath.isEmpty()) {
+        resolveParents(state->profilePath, state->profiles, state->stamps, 0);
+    } else {
+        qDebug() << "PortageProfileStack: No profile selected at" << makeProfile;
+    }
+
+    // /etc/portage/profile overrides the selected profile
+    const QString userProfile = QLatin1String(PortagePaths::USER_PROFILE);
+    state->stamps.insert(userProfile, FsUtils::modificationTime(userProfile));
+    if (QFileInfo(userProfile).isDir()) {
+        state->profiles << userProfile;
+    }
+
+    QHash<QString, QString> &variables = state->variables;
+    QHash<QString, QStringList> stacked; // incremental variable -> accumulated tokens
+    QSet<QString> negatedUse;
+
+    // A layer is evaluated on top of everything below it, only the variables it changed are merged
+    auto stackLayer = [&](const QHash<QString, QString> &layer) {
+        QStringList names = layer.keys();
+        // USE_EXPAND decides which other variables are incremental
+        std::sort(names.begin(), names.end(), [](const QString &a, const QString &b) {
+            return (a == QLatin1String("USE_EXPAND")) > (b == QLatin1String("USE_EXPAND"));
+        });
+
+        for (const QString &name : std::as_const(names)) {
+            const QString value = layer.value(name);
+            const auto previous = variables.constFind(name);
+            if (previous != variables.constEnd() && previous.value() == value) {
+                continue;
+            }
+            if (!isIncremental(name, stacked)) {
+                variables.insert(name, value);
+                continue;
+            }
+
+            const bool isUse = name == QLatin1String("USE");
+            QStringList &tokens = stacked[name];
+            const QStringList added = value.simplified().split(QLatin1Char(' '), Qt::SkipEmptyParts);
+            for (const QString &token : added) {
+                if (token == QLatin1String("-*")) {
+                    tokens.clear();
+                    if (isUse) {
+                        state->dropIuseDefaults = true;
+                    }
+                } else if (token.startsWith(QLatin1Char('-'))) {
+                    tokens.removeAll(token.mid(1));
+                    if (isUse) {
+                        negatedUse.insert(token.mid(1));
+                    }
+                } else {
+                    if (!tokens.contains(token)) {
+                        tokens << token;
+                    }
+                    if (isUse) {
+                        negatedUse.remove(token);
+                    }
+                }
+            }
+            variables.insert(name, tokens.join(QLatin1Char(' ')));
+        }
+    };
+
+    int order = 0;
+    for (const QString &profile : std::as_const(state->profiles)) {
+        const QString base = profile + QLatin1Char('/');
+
+        QHash<QString, QString> layer = variables;
+        MakeConfEvaluator::evaluate(base + QStringLiteral("make.defaults"), layer, state->stamps);
+        stackLayer(layer);
+
+        stackFlags(state->forced, PortageConfigIndex::readEntries(base + QStringLiteral("use.force"), &state->stamps));
+        stackFlags(state->masked, PortageConfigIndex::readEntries(base + QStringLiteral("use.mask"), &state->stamps));
+        stackFlags(state->stableForced,
+                   PortageConfigIndex::readEntries(base + QStringLiteral("use.stable.force"), &state->stamps));
+        stackFlags(state->stableMasked,
+                   PortageConfigIndex::readEntries(base + QStringLiteral("use.stable.mask"), &state->stamps));
+
+        addRules(state->packageUse, PortageConfigIndex::readEntries(base + QStringLiteral("package.use"), &state->stamps), order);
+        addRules(state->packageForced,
+                 PortageConfigIndex::readEntries(base + QStringLiteral("package.use.force"), &state->stamps), order);
+        addRules(state->packageMasked,
+                 PortageConfigIndex::readEntries(base + QStringLiteral("package.use.mask"), &state->stamps), order);
+        addRules(state->packageStableForced,
+                 PortageConfigIndex::readEntries(base + QStringLiteral("package.use.stable.force"), &state->stamps), order);
+        addRules(state->packageStableMasked,
+                 PortageConfigIndex::readEntries(base + QStringLiteral("package.use.stable.mask"), &state->stamps), order);
+
+        state->packageMasks << PortageConfigIndex::readEntries(base + QStringLiteral("package.mask"), &state->stamps);
+    }
+
+    // make.conf is the last layer
+    QHash<QString, QString> layer = variables;
+    MakeConfEvaluator::evaluate(QLatin1String(PortagePaths::MAKE_CONF), layer, state->stamps);
+    stackLayer(layer);
+
+    // A USE_EXPAND variable that is set replaces every flag with its prefix
+    QStringList use = stacked.value(QStringLiteral("USE"));
+    const QStringList useExpand = stacked.value(QStringLiteral("USE_EXPAND"));
+    for (const QString &name : useExpand) {
+        if (!variables.contains(name)) {
+            continue;
+        }
+        const QString prefix = name.toLower() + QLatin1Char('_');
+        use.removeIf([&prefix](const QString &flag) {
+            return flag.startsWith(prefix);
+        });
+        for (const QString &value : stacked.value(name)) {
+            use << prefix + value;
+        }
+    }
+    const QString arch = variables.value(QStringLiteral("ARCH"));
+    if (!arch.isEmpty()) {
+        use << arch;
+    }
+
+    state->use = UseFlagSet::fromFlags(use);
+    state->useDisabled = UseFlagSet::fromFlags(negatedUse.values());
+    state->useDisabled.subtract(state->use);
+    return state;
+}
+
+bool PortageProfileStack::isStale(const State &state) const
+{
+    if (QFileInfo(QLatin1String(PortagePaths::MAKE_PROFILE)).canonicalFilePath() != state.profilePath) {
+        return true;
+    }
+    for (auto it = state.stamps.constBegin(); it != state.stamps.constEnd(); ++it) {
+        if (FsUtils::modificationTime(it.key()) != it.value()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::shared_ptr<const PortageProfileStack::State> PortageProfileStack::state()
+{
+    QMutexLocker locker(&m_lock);
+
+    const qint64 now = QDeadlineTimer::current().deadline();
+    if (m_state && now - m_checkedAt < RECHECK_INTERVAL_MS) {
+        return m_state;
+    }
+    m_checkedAt = now;
+    if (m_state && !isStale(*m_state)) {
+        return m_state;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    std::shared_ptr<State> built = build();
+    qDebug() << "PortageProfileStack: Stacked" << built->profiles.size() << "profiles," << built->use.count()
+             << "USE flags," << built->stamps.size() << "paths in" << timer.elapsed() << "ms";
+    m_state = built;
+    return m_state;
+}
+
+PortageProfileStack::PackageUse PortageProfileStack::packageUse(const QString &atom, const QString &version,
+                                                                const QString &slot, const QString &repository,
+                                                                const QStringList &rawIuse, bool stable)
+{
+    const std::shared_ptr<const State> s = state();
+    UseFlagDictionary &dict = UseFlagDictionary::instance();
+
+    PackageUse result;
+
+    // IUSE defaults are the lowest layer, "-flag" anywhere in the stack turns them off
+    if (!s->dropIuseDefaults) {
+        for (const QString &flag : rawIuse) {
+            if (flag.startsWith(QLatin1Char('+'))) {
+                result.enabled.insert(dict.intern(flag.mid(1)));
+            }
+        }
+        result.enabled.subtract(s->useDisabled);
+    }
+    result.enabled |= s->use;
+    applyRules(s->packageUse, atom, version, slot, repository, result.enabled);
+
+    result.forced = s->forced;
+    result.masked = s->masked;
+    if (stable) {
+        result.forced |= s->stableForced;
+        result.masked |= s->stableMasked;
+    }
+    applyRules(s->packageForced, atom, version, slot, repository, result.forced);
+    applyRules(s->packageMasked, atom, version, slot, repository, result.masked);
+    if (stable) {
+        applyRules(s->packageStableForced, atom, version, slot, repository, result.forced);
+        applyRules(s->packageStableMasked, atom, version, slot, repository, result.masked);
+    }
+    return result;
+}
+
+QString PortageProfileStack::value(const QString &name)
+{
+    return state()->variables.value(name);
+}
+
+QStringList PortageProfileStack::profiles()
+{
+    return state()->profiles;
+}
+
+QList<PortageConfigIndex::Entry> PortageProfileStack::packageMasks()
+{
+    return state()->packageMasks;
+}
@@ -0,0 +1,112 @@
+/*
+ *   SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+#include <memory>
+
+#include "PortageConfigIndex.h"
+#include "../utils/PortageAtomSpec.h"
+#include "../utils/UseFlagSet.h"
+
+/**
+ * @brief The selected profile and make.conf, flattened into one USE state
+ *
+ * The /etc/portage/make.profile parent chain (plus /etc/portage/profile)
+ * is resolved once, parents first, and each node's make.defaults,
+ * use.force, use.mask, use.stable.*, package.use, package.use.force,
+ * package.use.mask, package.use.stable.* and package.mask is stacked the
+ * way Portage does it: incremental variables and flag lists accumulate,
+ * "-flag" removes and "-*" resets. make.conf is stacked on top, then the
+ * USE_EXPAND variables and ARCH are folded into USE. Flags are kept as
+ * UseFlagSet bitsets, so a package's USE is a handful of word operations
+ * on top of its IUSE.
+ *
+ * Every file and directory read is stamped; the state is rebuilt when one
+ * of the stamps or the make.profile target changes, checked at most once
+ * a second. /etc/portage/package.use is not part of the state, it comes
+ * from PortageConfigIndex. Thread-safe.
+ */
+class PortageProfileStack
+{
+public:
+    struct PackageUse {
+        UseFlagSet enabled; // IUSE defaults, stacked USE and profile package.use
+        UseFlagSet forced;  // use.force and package.use.force (stable variants included)
+        UseFlagSet masked;  // use.mask and package.use.mask, wins over forced
+    };
+
+    static PortageProfileStack &instance();
+
+    // USE of a package before /etc/portage/package.use is applied;
+    // stable selects the use.stable.* and package.use.stable.* layers
+    PackageUse packageUse(const QString &atom, const QString &version, const QString &slot,
+                          const QString &repository, const QStringList &rawIuse, bool stable);
+
+    // Value of a variable after make.defaults and make.conf, incremental ones stacked
+    QString value(const QString &name);
+
+    // Profile directories, parents first
+    QStringList profiles();
+
+    // package.mask entries of the profile stack, in stacking order
+    QList<PortageConfigIndex::Entry> packageMasks();
+
+private:
+    struct PackageRule {
+        PortageAtomSpec spec;
+        UseFlagSet on;
+        UseFlagSet off;
+        int order = 0;
+    };
+    using PackageRules = QHash<QString, QList<PackageRule>>; // lowercase atom ("" for wildcards) -> rules
+
+    struct State {
+        QString profilePath; // make.profile target
+        QStringList profiles;
+        QHash<QString, QString> variables;
+        QHash<QString, qint64> stamps;
+
+        UseFlagSet use;
+        UseFlagSet useDisabled; // flags turned off by "-flag", they override IUSE defaults
+        bool dropIuseDefaults = false; // USE="-*" somewhere in the stack
+        UseFlagSet forced;
+        UseFlagSet masked;
+        UseFlagSet stableForced;
+        UseFlagSet stableMasked;
+
+        PackageRules packageUse;
+        PackageRules packageForced;
+        PackageRules packageMasked;
+        PackageRules packageStableForced;
+        PackageRules packageStableMasked;
+
+        QList<PortageConfigIndex::Entry> packageMasks;
+    };
+
+    PortageProfileStack();
+
+    std::shared_ptr<const State> state();
+    bool isStale(const State &state) const;
+
+    static std::shared_ptr<State> build();
+    static void resolveParents(const QString &path, QStringList &profiles, QHash<QString, qint64> &stamps, int depth);
+    static void addRules(PackageRules &rules, const QList<PortageConfigIndex::Entry> &entries, int &order);
+    static void applyRules(const PackageRules &rules, const QString &atom, const QString &version, const QString &slot,
+                           const QString &repository, UseFlagSet &flags);
+
+    static constexpr qint64 RECHECK_INTERVAL_MS = 1000;
+    static constexpr int MAX_PARENT_DEPTH = 32;
+
+    std::shared_ptr<const State> m_state;
+    qint64 m_checkedAt = 0;
+    QMutex m_lock;
+};
@@ -115,6 +115,12 @@ void UseFlagsDialog::loadUseFlags()
                 checkbox->setToolTip(desc);
             }
             
+            // The profile decides these, package.use can't change them
+            if (effective.masked.contains(flag) || effective.forced.contains(flag)) {
+                checkbox->setEnabled(false);
+                checkbox->setToolTip(effective.masked.contains(flag) ? i18n("Masked by the profile") : i18n("Forced by the profile"));
+            }
+            
             iuseLayout->addWidget(checkbox);
             
             UseFlagCheckbox ufcb;
@@ -4,6 +4,7 @@
  */
 
 #include "UnmaskManager.h"
+#include "../config/PortageConfigIndex.h"
 #include "../utils/StringUtils.h"
 #include "../utils/PortagePaths.h"
 #include <QFile>
@@ -70,13 +71,10 @@ bool UnmaskManager::maskPackage(const QString &atom)
 
 bool UnmaskManager::isUnmasked(const QString &atom) const
 {
-    QStringList lines;
-    if (!readUnmaskFile(lines)) {
-        return false;
-    }
-    
-    for (const QString &line : lines) {
-        if (line.trimmed().startsWith(atom + QLatin1Char(' '))) {
+    const QList<PortageConfigIndex::Entry> entries =
+        PortageConfigIndex::instance().entriesFor(PortageConfigIndex::PackageAcceptKeywords, atom);
+    for (const PortageConfigIndex::Entry &entry : entries) {
+        if (entry.file == m_unmaskFilePath && entry.atom == atom && !entry.values.isEmpty()) {
             return true;
         }
     }
@@ -87,22 +85,12 @@ bool UnmaskManager::isUnmasked(const QString &atom) const
 QStringList UnmaskManager::getUnmaskedPackages() const
 {
     QStringList packages;
-    QStringList lines;
     
-    if (!readUnmaskFile(lines)) {
-        return packages;
-    }
-    
-    for (const QString &line : lines) {
-        QString trimmed = line.trimmed();
-        if (trimmed.isEmpty() || trimmed.startsWith(QLatin1Char('#'))) {
-            continue;
-        }
-        
-        // Extract atom (first part before space)
-        int spaceIdx = trimmed.indexOf(QLatin1Char(' '));
-        if (spaceIdx > 0) {
-            packages.append(trimmed.left(spaceIdx));
+    const QList<PortageConfigIndex::Entry> entries =
+        PortageConfigIndex::instance().entries(PortageConfigIndex::PackageAcceptKeywords);
+    for (const PortageConfigIndex::Entry &entry : entries) {
+        if (entry.file == m_unmaskFilePath && !entry.values.isEmpty()) {
+            packages.append(entry.atom);
         }
     }
     
@@ -168,6 +156,7 @@ void UnmaskManager::writeUnmaskFileAsync(const QStringList &lines, std::function
         KAuth::ExecuteJob *authJob = static_cast<KAuth::ExecuteJob *>(finishedJob);
         bool success = (authJob->error() == 0);
         if (success) {
+            PortageConfigIndex::instance().invalidate();
             qDebug() << "UnmaskManager: Successfully wrote unmask file via KAuth";
         } else {
             qWarning() << "UnmaskManager: KAuth action failed:" << authJob->errorString();
@@ -208,7 +197,11 @@ bool UnmaskManager::writeUnmaskFile(const QStringList &lines) const
     KAuth::ExecuteJob *job = writeAction.execute();
     job->exec();  // Synchronous
     
-    return (job->error() == 0);
+    if (job->error() != 0) {
+        return false;
+    }
+    PortageConfigIndex::instance().invalidate();
+    return true;
 }
 
 QString UnmaskManager::getFileHeader() const
@@ -7,12 +7,34 @@
 #include "../backend/PortageBackend.h"
 #include "../resources/PortageUseFlags.h"
 #include "../utils/AtomParser.h"
+#include "../utils/FsUtils.h"
 #include "../utils/PortagePaths.h"
+#include "../utils/PortageVersion.h"
 
+#include <QDataStream>
 #include <QDir>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QFile>
-#include <QRegularExpression>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtConcurrent>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+QDataStream &operator<<(QDataStream &out, const InstalledPackageInfo &info)
+{
+    return out << info.atom << info.version << info.repository << info.slot << info.useFlags << info.availableUseFlags
+               << info.description << info.size << info.buildTime << info.installedSlots;
+}
+
+QDataStream &operator>>(QDataStream &in, InstalledPackageInfo &info)
+{
+    return in >> info.atom >> info.version >> info.repository >> info.slot >> info.useFlags >> info.availableUseFlags
+              >> info.description >> info.size >> info.buildTime >> info.installedSlots;
+}
 
 PortageInstalledReader::PortageInstalledReader(PortageBackend *backend, QObject *parent)
     : QObject(parent)
@@ -24,83 +46,265 @@ PortageInstalledReader::PortageInstalledReader(PortageBackend *backend, QObject
 void PortageInstalledReader::loadInstalledPackages()
 {
     qDebug() << "Portage: InstalledReader loading from" << m_pkgDbPath;
-    QDir pkgdir(m_pkgDbPath);
-    if (!pkgdir.exists()) {
-        qDebug() << "Portage: pkg db path does not exist:" << m_pkgDbPath;
-        Q_EMIT packagesLoaded(0);
+    QElapsedTimer timer;
+    timer.start();
+    
+    // Taken before scanning: a merge that races the scan makes the snapshot stale, not wrong
+    const QHash<QString, qint64> stamps = vdbStamps();
+    
+    if (loadSnapshot(stamps)) {
+        qDebug() << "Portage: InstalledReader reused snapshot with" << m_installedVersions.size()
+                 << "installed packages in" << timer.elapsed() << "ms";
+        Q_EMIT packagesLoaded(m_installedVersions.size());
         return;
     }
-
+    
     scanPkgDb(m_pkgDbPath);
-    qDebug() << "Portage: InstalledReader found" << m_installedVersions.size() << "installed packages";
+    qDebug() << "Portage: InstalledReader found" << m_installedVersions.size() << "installed packages in"
+             << timer.elapsed() << "ms";
+    
+    if (!stamps.isEmpty()) {
+        saveSnapshot(stamps);
+    }
     Q_EMIT packagesLoaded(m_installedVersions.size());
 }
 
+QString PortageInstalledReader::snapshotFilePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+        + QStringLiteral("/discover-portage/vdb.bin");
+}
+
+QHash<QString, qint64> PortageInstalledReader::vdbStamps()
+{
+    QHash<QString, qint64> stamps;
+    
+    const int pkgDbFd = FsUtils::openDirectory(QLatin1String(PortagePaths::PKG_DB));
+    if (pkgDbFd < 0) {
+        return stamps;
+    }
+    
+    // Portage bumps the counter on every merge, unmerges only show up as
+    // a changed category directory (or a category disappearing)
+    QFile counterFile(QLatin1String(PortagePaths::PKG_COUNTER));
+    if (counterFile.open(QIODevice::ReadOnly)) {
+        stamps.insert(QStringLiteral("counter"), counterFile.readAll().trimmed().toLongLong());
+    }
+    
+    const QStringList categories = FsUtils::listDirectory(pkgDbFd, FsUtils::EntryType::Directories);
+    for (const QString &category : categories) {
+        struct stat st;
+        if (::fstatat(pkgDbFd, QFile::encodeName(category).constData(), &st, 0) == 0) {
+            stamps.insert(category, qint64(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec);
+        }
+    }
+    
+    ::close(pkgDbFd);
+    return stamps;
+}
+
+bool PortageInstalledReader::loadSnapshot(const QHash<QString, qint64> &stamps)
+{
+    QFile file(snapshotFilePath());
+    if (stamps.isEmpty() || !file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_5);
+    
+    quint32 magic = 0;
+    quint32 version = 0;
+    QHash<QString, qint64> savedStamps;
+    in >> magic >> version;
+    if (magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION) {
+        qDebug() << "Portage: InstalledReader snapshot format mismatch";
+        return false;
+    }
+    
+    in >> savedStamps;
+    if (savedStamps != stamps) {
+        qDebug() << "Portage: InstalledReader snapshot is stale";
+        return false;
+    }
+    
+    QHash<QString, InstalledPackageInfo> installedInfo;
+    in >> installedInfo;
+    if (in.status() != QDataStream::Ok) {
+        qDebug() << "Portage: InstalledReader snapshot is corrupt";
+        return false;
+    }
+    
+    m_installedInfo = installedInfo;
+    m_installedVersions.clear();
+    m_installedVersions.reserve(m_installedInfo.size());
+    for (auto it = m_installedInfo.constBegin(); it != m_installedInfo.constEnd(); ++it) {
+        m_installedVersions.insert(it.key(), it.value().version);
+    }
+    return true;
+}
+
+bool PortageInstalledReader::saveSnapshot(const QHash<QString, qint64> &stamps) const
+{
+    const QString path = snapshotFilePath();
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+        qWarning() << "Portage: InstalledReader could not create cache directory for" << path;
+        return false;
+    }
+    
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Portage: InstalledReader could not write" << path << ":" << file.errorString();
+        return false;
+    }
+    
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_5);
+    out << SNAPSHOT_MAGIC << SNAPSHOT_VERSION << stamps << m_installedInfo;
+    
+    if (!file.commit()) {
+        qWarning() << "Portage: InstalledReader failed to write" << path << ":" << file.errorString();
+        return false;
+    }
+    return true;
+}
+
 void PortageInstalledReader::scanPkgDb(const QString &path)
 {
-    QDir top(path);
-    const QFileInfoList categories = top.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
-    for (const QFileInfo &catInfo : categories) {
-        const QString category = catInfo.fileName();
-        QDir catDir(catInfo.absoluteFilePath());
-        const QFileInfoList pkgDirs = catDir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
-        for (const QFileInfo &pkgInfo : pkgDirs) {
-            const QString dirname = pkgInfo.fileName();
-            
-            // Try to match against known packages first for better accuracy
-            QString pkg;
-            QString ver;
-            const QString fullAtom = category + QLatin1Char('/');
+    const int pkgDbFd = FsUtils::openDirectory(path);
+    if (pkgDbFd < 0) {
+        qDebug() << "Portage: pkg db path does not exist:" << path;
+        return;
+    }
+    const QStringList categories = FsUtils::listDirectory(pkgDbFd, FsUtils::EntryType::Directories);
+    ::close(pkgDbFd);
+    
+    m_installedInfo = readCategories(categories, m_knownAtoms);
+    m_installedVersions.clear();
+    m_installedVersions.reserve(m_installedInfo.size());
+    for (auto it = m_installedInfo.constBegin(); it != m_installedInfo.constEnd(); ++it) {
+        m_installedVersions.insert(it.key(), it.value().version);
+    }
+}
+
+QHash<QString, InstalledPackageInfo> PortageInstalledReader::readCategories(const QStringList &categories,
+                                                                            const QSet<QString> &knownAtoms)
+{
+    QHash<QString, InstalledPackageInfo> installedInfo;
+    
+    const int pkgDbFd = FsUtils::openDirectory(QLatin1String(PortagePaths::PKG_DB));
+    if (pkgDbFd < 0) {
+        return installedInfo;
+    }
+    
+    // One job per category, every package costs a handful of openat/pread calls
+    const QList<CategoryResult> results = QtConcurrent::blockingMapped(categories,
+        [pkgDbFd, &knownAtoms](const QString &category) {
+            return scanCategory(pkgDbFd, category, knownAtoms);
+        });
+    ::close(pkgDbFd);
+    
+    QHash<QString, QHash<QString, QString>> slots; // atom -> SLOT -> version
+    for (const CategoryResult &result : results) {
+        for (const auto &entry : result) {
+            slots[entry.first].insert(entry.second.slot, entry.second.version);
             
-            bool foundMatch = false;
-            if (!m_knownAtoms.isEmpty()) {
-                for (int i = dirname.length() - 1; i >= 0; --i) {
-                    if (dirname[i] == QLatin1Char('-') && i + 1 < dirname.length() && dirname[i + 1].isDigit()) {
-                        QString testPkg = dirname.left(i);
-                        QString testAtom = fullAtom + testPkg;
-                        
-                        if (m_knownAtoms.contains(testAtom.toLower())) {
-                            pkg = testPkg;
-                            ver = dirname.mid(i + 1);
-                            foundMatch = true;
-                            break;
-                        }
-                    }
-                }
+            // Several slots installed: report the newest one, the update check looks at each
+            const auto existing = installedInfo.constFind(entry.first);
+            if (existing != installedInfo.constEnd()
+                && PortageVersion::compare(existing.value().version, entry.second.version) >= 0) {
+                continue;
             }
+            installedInfo.insert(entry.first, entry.second);
+        }
+    }
+    
+    for (auto it = slots.constBegin(); it != slots.constEnd(); ++it) {
+        if (it.value().size() > 1) {
+            installedInfo[it.key()].installedSlots = it.value();
+        }
+    }
+    return installedInfo;
+}
 
-            if (!foundMatch) {
-                QRegularExpression versionRe(QStringLiteral("^(.+)-(\\d.*)$"));
-                QRegularExpressionMatch match = versionRe.match(dirname);
-                
-                if (!match.hasMatch())
-                    continue;
-                    
-                pkg = match.captured(1);
-                ver = match.captured(2);
-            }
-            
-            const QString atom = fullAtom + pkg;
+PortageInstalledReader::CategoryResult PortageInstalledReader::scanCategory(int pkgDbFd, const QString &category,
+                                                                             const QSet<QString> &knownAtoms)
+{
+    CategoryResult result;
+    
+    const int catFd = FsUtils::openDirectoryAt(pkgDbFd, category);
+    if (catFd < 0) {
+        return result;
+    }
+    
+    const QStringList pkgDirs = FsUtils::listDirectory(catFd, FsUtils::EntryType::Directories);
+    result.reserve(pkgDirs.size());
+    for (const QString &dirname : pkgDirs) {
+        // Merges in progress, the final directory appears once it's complete
+        if (dirname.startsWith(QLatin1String("-MERGING-"))) {
+            continue;
+        }
+        
+        QString pkg;
+        QString ver;
+        if (!splitPackageDir(category, dirname, knownAtoms, pkg, ver)) {
+            continue;
+        }
+        
+        const int pkgFd = FsUtils::openDirectoryAt(catFd, dirname);
+        if (pkgFd < 0) {
+            continue;
+        }
+        
+        InstalledPackageInfo info;
+        info.atom = category + QLatin1Char('/') + pkg;
+        info.version = ver;
+        info.repository = QString::fromUtf8(FsUtils::readFileAt(pkgFd, "repository").trimmed());
+        info.slot = QString::fromUtf8(FsUtils::readFileAt(pkgFd, "SLOT").trimmed());
+        info.useFlags = PortageUseFlags::parseUSE(QString::fromUtf8(FsUtils::readFileAt(pkgFd, "USE").trimmed()));
+        info.availableUseFlags = PortageUseFlags::parseIUSE(QString::fromUtf8(FsUtils::readFileAt(pkgFd, "IUSE").trimmed()));
+        info.description = QString::fromUtf8(FsUtils::readFileAt(pkgFd, "DESCRIPTION").trimmed());
+        info.size = FsUtils::readFileAt(pkgFd, "SIZE").trimmed().toLongLong();
+        info.buildTime = FsUtils::readFileAt(pkgFd, "BUILD_TIME").trimmed().toLongLong();
+        ::close(pkgFd);
+        
+        result.append(qMakePair(info.atom.toLower(), info));
+    }
+    
+    ::close(catFd);
+    return result;
+}
 
-            InstalledPackageInfo info;
-            info.version = ver;
-            
-            const QString pkgPath = pkgInfo.absoluteFilePath();
-            info.repository = readFileContent(pkgPath + QStringLiteral("/repository"));
-            info.slot = readFileContent(pkgPath + QStringLiteral("/SLOT"));
-            
-            // Read USE flags
-            const QString useContent = readFileContent(pkgPath + QStringLiteral("/USE"));
-            info.useFlags = PortageUseFlags::parseUSE(useContent);
-            
-            // Read available USE flags (IUSE)
-            const QString iuseContent = readFileContent(pkgPath + QStringLiteral("/IUSE"));
-            info.availableUseFlags = PortageUseFlags::parseIUSE(iuseContent);
-            
-            m_installedVersions.insert(atom.toLower(), ver);
-            m_installedInfo.insert(atom.toLower(), info);
+bool PortageInstalledReader::splitPackageDir(const QString &category, const QString &dirname,
+                                             const QSet<QString> &knownAtoms, QString &pkg, QString &ver)
+{
+    // <package>-<version>: the version starts after the last "-<digit>" that leaves
+    // a known package name, or simply after the last one
+    int fallback = -1;
+    for (int i = dirname.length() - 2; i > 0; --i) {
+        if (dirname[i] != QLatin1Char('-') || !dirname[i + 1].isDigit()) {
+            continue;
+        }
+        if (fallback < 0) {
+            fallback = i;
+            if (knownAtoms.isEmpty()) {
+                break;
+            }
         }
+        const QString testAtom = category + QLatin1Char('/') + dirname.left(i);
+        if (knownAtoms.contains(testAtom.toLower())) {
+            fallback = i;
+            break;
+        }
+    }
+    
+    if (fallback < 0) {
+        return false;
     }
+    
+    pkg = dirname.left(fallback);
+    ver = dirname.mid(fallback + 1);
+    return true;
 }
 
 bool PortageInstalledReader::isPackageInstalled(const QString &atom) const
@@ -150,24 +354,23 @@ QString PortageInstalledReader::findPackageVersion(const QString &atom)
         return QString();
     }
     
+    // "foo-bar-1.0" also starts with "foo-", only take entries whose rest is a version
+    const QString prefix = packageName + QLatin1Char('-');
+    PortageVersion newest;
+    QString newestVersion;
+    
     QStringList entries = categoryDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
     for (const QString &entry : entries) {
-        if (entry.startsWith(packageName + QLatin1Char('-'))) {
-            QString version = entry.mid(packageName.length() + 1);
-            return version;
+        if (!entry.startsWith(prefix)) {
+            continue;
+        }
+        const QString version = entry.mid(prefix.length());
+        const PortageVersion parsed(version);
+        if (parsed.isValid() && (newestVersion.isEmpty() || parsed > newest)) {
+            newest = parsed;
+            newestVersion = version;
         }
     }
     
-    return QString();
-}
-
-QString PortageInstalledReader::readFileContent(const QString &filePath)
-{
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        return QString();
-    }
-    QString content = QString::fromUtf8(file.readAll()).trimmed();
-    file.close();
-    return content;
+    return newestVersion;
 }
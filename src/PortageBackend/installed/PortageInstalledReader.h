@@ -7,18 +7,37 @@
 
 #include <QObject>
 #include <QHash>
+#include <QList>
+#include <QPair>
 #include <QSet>
 
 class PortageBackend;
+class QDataStream;
 
 struct InstalledPackageInfo {
+    QString atom; // category/package as spelled in /var/db/pkg, hash keys are lowercase
     QString version;
     QString repository;
     QString slot;
     QStringList useFlags;
     QStringList availableUseFlags; // from IUSE
+    QString description;
+    qint64 size = 0;      // installed size in bytes
+    qint64 buildTime = 0; // seconds since epoch
+    QHash<QString, QString> installedSlots; // SLOT -> version of every installed slot, empty if only one is
+    
+    bool operator==(const InstalledPackageInfo &other) const
+    {
+        return atom == other.atom && version == other.version && repository == other.repository
+            && slot == other.slot && useFlags == other.useFlags && availableUseFlags == other.availableUseFlags
+            && buildTime == other.buildTime && installedSlots == other.installedSlots;
+    }
+    bool operator!=(const InstalledPackageInfo &other) const { return !(*this == other); }
 };
 
+QDataStream &operator<<(QDataStream &out, const InstalledPackageInfo &info);
+QDataStream &operator>>(QDataStream &in, InstalledPackageInfo &info);
+
 class PortageInstalledReader : public QObject
 {
     Q_OBJECT
@@ -43,17 +62,35 @@ public:
     
     // Static helper: find any installed version for atom
     static QString findPackageVersion(const QString &atom);
+    
+    // State of /var/db/pkg: portage's merge counter plus every category directory mtime
+    static QHash<QString, qint64> vdbStamps();
+    
+    static QString snapshotFilePath();
+    
+    // Parse the given /var/db/pkg categories only (atom -> info), used for live updates
+    static QHash<QString, InstalledPackageInfo> readCategories(const QStringList &categories,
+                                                               const QSet<QString> &knownAtoms = QSet<QString>());
 
 Q_SIGNALS:
     void packagesLoaded(int count);
 
 private:
+    using CategoryResult = QList<QPair<QString, InstalledPackageInfo>>;
+
     void scanPkgDb(const QString &path);
-    QString readFileContent(const QString &filePath);
+    bool loadSnapshot(const QHash<QString, qint64> &stamps);
+    bool saveSnapshot(const QHash<QString, qint64> &stamps) const;
+    static CategoryResult scanCategory(int pkgDbFd, const QString &category, const QSet<QString> &knownAtoms);
+    static bool splitPackageDir(const QString &category, const QString &dirname, const QSet<QString> &knownAtoms,
+                                QString &pkg, QString &ver);
 
     PortageBackend *m_backend;
     QHash<QString, QString> m_installedVersions; // atom -> version (for backwards compat)
-    QHash<QString, InstalledPackageInfo> m_installedInfo; // atom -> full info
+    QHash<QString, InstalledPackageInfo> m_installedInfo; // atom (lowercase) -> full info
     QSet<QString> m_knownAtoms; // Known package atoms from repository
     QString m_pkgDbPath;
+    
+    static constexpr quint32 SNAPSHOT_MAGIC = 0x50564442; // "PVDB"
+    static constexpr quint32 SNAPSHOT_VERSION = 3;
 };
@@ -0,0 +1,82 @@
+/*
+ * SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include "PortageVdbWatcher.h"
+#include "../utils/FsUtils.h"
+#include "../utils/PortagePaths.h"
+
+#include <QDebug>
+#include <QFileSystemWatcher>
+#include <QTimer>
+
+PortageVdbWatcher::PortageVdbWatcher(QObject *parent)
+    : QObject(parent)
+    , m_watcher(new QFileSystemWatcher(this))
+    , m_batchTimer(new QTimer(this))
+    , m_pkgDbPath(QLatin1String(PortagePaths::PKG_DB))
+{
+    // A merge touches its category several times (-MERGING- dir, rename, old version removal)
+    m_batchTimer->setSingleShot(true);
+    m_batchTimer->setInterval(300);
+    connect(m_batchTimer, &QTimer::timeout, this, &PortageVdbWatcher::flush);
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &PortageVdbWatcher::onDirectoryChanged);
+
+    if (!m_watcher->addPath(m_pkgDbPath)) {
+        qWarning() << "PortageVdbWatcher: Could not watch" << m_pkgDbPath;
+        return;
+    }
+    updateWatchedCategories();
+    m_dirty.clear();
+
+    qDebug() << "PortageVdbWatcher: Watching" << m_categories.size() << "categories";
+}
+
+void PortageVdbWatcher::onDirectoryChanged(const QString &path)
+{
+    if (path == m_pkgDbPath) {
+        // Categories appear with their first package and vanish with the last one
+        updateWatchedCategories();
+    } else {
+        m_dirty.insert(path.section(QLatin1Char('/'), -1));
+    }
+
+    if (!m_dirty.isEmpty() && !m_batchTimer->isActive()) {
+        m_batchTimer->start();
+    }
+}
+
+void PortageVdbWatcher::updateWatchedCategories()
+{
+    const QStringList listed = FsUtils::listDirectory(m_pkgDbPath, FsUtils::EntryType::Directories);
+    const QSet<QString> current(listed.cbegin(), listed.cend());
+
+    for (const QString &category : current) {
+        if (!m_categories.contains(category)) {
+            m_watcher->addPath(m_pkgDbPath + QLatin1Char('/') + category);
+            m_dirty.insert(category);
+        }
+    }
+    for (const QString &category : std::as_const(m_categories)) {
+        if (!current.contains(category)) {
+            // QFileSystemWatcher drops removed directories by itself
+            m_dirty.insert(category);
+        }
+    }
+
+    m_categories = current;
+}
+
+void PortageVdbWatcher::flush()
+{
+    if (m_dirty.isEmpty()) {
+        return;
+    }
+
+    const QStringList categories = m_dirty.values();
+    m_dirty.clear();
+
+    qDebug() << "PortageVdbWatcher: Installed packages changed in" << categories;
+    Q_EMIT categoriesChanged(categories);
+}
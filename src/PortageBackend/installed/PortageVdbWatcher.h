@@ -0,0 +1,43 @@
+/*
+ * SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#pragma once
+
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+
+class QFileSystemWatcher;
+class QTimer;
+
+/**
+ * @brief Watches /var/db/pkg for merges and unmerges
+ *
+ * Every category directory is watched (inotify on Linux). Portage creates
+ * and renames package directories there on merge and removes them on
+ * unmerge, no matter whether emerge was started by Discover or from a
+ * terminal. Events are batched and reported per category.
+ */
+class PortageVdbWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PortageVdbWatcher(QObject *parent = nullptr);
+
+Q_SIGNALS:
+    // Categories whose installed packages may have changed since the last emission
+    void categoriesChanged(const QStringList &categories);
+
+private:
+    void onDirectoryChanged(const QString &path);
+    void updateWatchedCategories();
+    void flush();
+
+    QFileSystemWatcher *m_watcher;
+    QTimer *m_batchTimer;
+    QString m_pkgDbPath;
+    QSet<QString> m_categories;   // watched category names
+    QSet<QString> m_dirty;        // changed since the last flush
+};
@@ -0,0 +1,244 @@
+/*
+ * SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include "PortageMetadataCache.h"
+#include "../utils/AtomParser.h"
+#include "../utils/FsUtils.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QRegularExpression>
+
+namespace
+{
+using MetadataField = QString EbuildMetadata::*;
+
+struct CacheKey {
+    const char *key;
+    MetadataField field;
+};
+
+const CacheKey cacheKeys[] = {
+    {"EAPI", &EbuildMetadata::eapi},
+    {"DESCRIPTION", &EbuildMetadata::description},
+    {"HOMEPAGE", &EbuildMetadata::homepage},
+    {"IUSE", &EbuildMetadata::iuse},
+    {"KEYWORDS", &EbuildMetadata::keywords},
+    {"SLOT", &EbuildMetadata::slot},
+    {"LICENSE", &EbuildMetadata::license},
+    {"DEPEND", &EbuildMetadata::depend},
+    {"RDEPEND", &EbuildMetadata::rdepend},
+    {"BDEPEND", &EbuildMetadata::bdepend},
+    {"PDEPEND", &EbuildMetadata::pdepend},
+    {"IDEPEND", &EbuildMetadata::idepend},
+    {"REQUIRED_USE", &EbuildMetadata::requiredUse},
+};
+
+MetadataField fieldForKey(QByteArrayView key)
+{
+    for (const CacheKey &cacheKey : cacheKeys) {
+        if (key == cacheKey.key) {
+            return cacheKey.field;
+        }
+    }
+    return nullptr;
+}
+}
+
+PortageMetadataCache &PortageMetadataCache::instance()
+{
+    static PortageMetadataCache inst;
+    return inst;
+}
+
+PortageMetadataCache::PortageMetadataCache()
+{
+}
+
+QString PortageMetadataCache::packageKey(const QString &repoPath, const QString &atom)
+{
+    return repoPath + QLatin1Char('|') + atom;
+}
+
+EbuildMetadata PortageMetadataCache::metadata(const QString &repoPath, const QString &atom, const QString &version)
+{
+    return package(repoPath, atom).byVersion.value(version);
+}
+
+QList<EbuildMetadata> PortageMetadataCache::packageMetadata(const QString &repoPath, const QString &atom)
+{
+    const PackageMetadata pkg = package(repoPath, atom);
+
+    QList<EbuildMetadata> result;
+    result.reserve(pkg.versions.size());
+    for (const QString &version : pkg.versions) {
+        result << pkg.byVersion.value(version);
+    }
+    return result;
+}
+
+void PortageMetadataCache::invalidate(const QString &repoPath, const QString &atom)
+{
+    QWriteLocker locker(&m_lock);
+    ++m_epoch;
+
+    if (!atom.isEmpty()) {
+        m_packages.remove(packageKey(repoPath, atom));
+        return;
+    }
+
+    const QString prefix = repoPath + QLatin1Char('|');
+    m_packages.removeIf([&prefix](const QHash<QString, PackageMetadata>::iterator &it) {
+        return it.key().startsWith(prefix);
+    });
+}
+
+PortageMetadataCache::PackageMetadata PortageMetadataCache::package(const QString &repoPath, const QString &atom)
+{
+    if (repoPath.isEmpty() || atom.isEmpty()) {
+        return PackageMetadata();
+    }
+
+    const QString key = packageKey(repoPath, atom);
+    quint64 epoch;
+    {
+        QReadLocker locker(&m_lock);
+        const auto it = m_packages.constFind(key);
+        if (it != m_packages.constEnd()) {
+            return it.value();
+        }
+        epoch = m_epoch;
+    }
+
+    // Load outside the lock, a concurrent load of the same package is harmless
+    const PackageMetadata loaded = loadPackage(repoPath, atom);
+
+    QWriteLocker locker(&m_lock);
+    // Invalidated while loading: the files may have changed under the reader, don't keep it
+    if (epoch == m_epoch) {
+        m_packages.insert(key, loaded);
+    }
+    return loaded;
+}
+
+PortageMetadataCache::PackageMetadata PortageMetadataCache::loadPackage(const QString &repoPath, const QString &atom)
+{
+    PackageMetadata pkg;
+
+    const QString pkgName = AtomParser::extractPackageName(atom);
+    const QString pkgPath = repoPath + QLatin1Char('/') + atom;
+    const QString ebuildPrefix = pkgName + QLatin1Char('-');
+
+    const QStringList files = FsUtils::listDirectory(pkgPath, FsUtils::EntryType::Files);
+    for (const QString &file : files) {
+        if (!file.endsWith(QLatin1String(".ebuild")) || !file.startsWith(ebuildPrefix)) {
+            continue;
+        }
+
+        const QString version = file.mid(ebuildPrefix.length(), file.length() - ebuildPrefix.length() - 7);
+        if (version.isEmpty()) {
+            continue;
+        }
+
+        const EbuildMetadata md = loadVersion(repoPath, atom, version);
+        pkg.versions << md.version;
+        pkg.byVersion.insert(md.version, md);
+    }
+
+    return pkg;
+}
+
+EbuildMetadata PortageMetadataCache::loadVersion(const QString &repoPath, const QString &atom, const QString &version)
+{
+    EbuildMetadata md;
+    md.version = version;
+
+    const QString cachePath = repoPath + QStringLiteral("/metadata/md5-cache/") + atom + QLatin1Char('-') + version;
+    if (!readCacheEntry(cachePath, md)) {
+        // No md5-cache (most overlays): eclass-provided values are missing here
+        const QString ebuildPath = repoPath + QLatin1Char('/') + atom + QLatin1Char('/')
+            + AtomParser::extractPackageName(atom) + QLatin1Char('-') + version + QStringLiteral(".ebuild");
+        parseEbuild(ebuildPath, md);
+    }
+    return md;
+}
+
+bool PortageMetadataCache::readCacheEntry(const QString &path, EbuildMetadata &metadata)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const QByteArray data = file.readAll();
+    return parseCacheEntry(data, metadata);
+}
+
+bool PortageMetadataCache::parseCacheEntry(QByteArrayView data, EbuildMetadata &metadata)
+{
+    bool found = false;
+
+    while (!data.isEmpty()) {
+        const qsizetype eol = data.indexOf('\n');
+        const QByteArrayView line = eol < 0 ? data : data.first(eol);
+        data = eol < 0 ? QByteArrayView() : data.sliced(eol + 1);
+
+        const qsizetype eq = line.indexOf('=');
+        if (eq <= 0) {
+            continue;
+        }
+
+        const MetadataField field = fieldForKey(line.first(eq));
+        if (field) {
+            metadata.*field = QString::fromUtf8(line.sliced(eq + 1));
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+bool PortageMetadataCache::parseEbuild(const QString &path, EbuildMetadata &metadata)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qDebug() << "PortageMetadataCache: Could not open ebuild" << path;
+        return false;
+    }
+    const QString contents = QString::fromUtf8(file.readAll());
+
+    // VAR="value" (may span lines), VAR='value' or VAR=value, IUSE may also be appended with +=
+    static const QRegularExpression varRe(QStringLiteral(
+        R"re(^[ \t]*(EAPI|DESCRIPTION|HOMEPAGE|IUSE|KEYWORDS|SLOT|LICENSE|REQUIRED_USE)(\+?)=(?:"([^"]*)"|'([^']*)'|(\S*)))re"),
+        QRegularExpression::MultilineOption);
+
+    bool found = false;
+    QRegularExpressionMatchIterator it = varRe.globalMatch(contents);
+    while (it.hasNext()) {
+        const QRegularExpressionMatch match = it.next();
+        const MetadataField field = fieldForKey(match.captured(1).toLatin1());
+        if (!field) {
+            continue;
+        }
+
+        QString value = match.captured(3);
+        if (value.isEmpty()) {
+            value = match.captured(4);
+        }
+        if (value.isEmpty()) {
+            value = match.captured(5);
+        }
+        value = value.simplified();
+
+        QString &target = metadata.*field;
+        if (!match.captured(2).isEmpty() && !target.isEmpty()) {
+            target += QLatin1Char(' ') + value;
+        } else {
+            target = value;
+        }
+        found = true;
+    }
+
+    return found;
+}
@@ -0,0 +1,84 @@
+/*
+ * SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#pragma once
+
+#include <QByteArrayView>
+#include <QHash>
+#include <QReadWriteLock>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief Metadata of a single ebuild version
+ *
+ * Values are kept exactly as found in md5-cache (IUSE keeps its +/- defaults).
+ */
+struct EbuildMetadata {
+    QString version;
+    QString eapi;
+    QString description;
+    QString homepage;
+    QString iuse;
+    QString keywords;
+    QString slot;
+    QString license;
+    QString depend;
+    QString rdepend;
+    QString bdepend;
+    QString pdepend;
+    QString idepend;
+    QString requiredUse;
+
+    bool isValid() const { return !version.isEmpty(); }
+};
+
+/**
+ * @brief Process-wide ebuild metadata engine
+ *
+ * Reads <repo>/metadata/md5-cache/<category>/<package>-<version> entries
+ * for every version of a package the first time the package is requested,
+ * falling back to plain ebuild variable parsing for repositories without
+ * a metadata cache. Lookups by (repository, atom, version) are hash probes
+ * after that. A package read while invalidate() ran is returned but not
+ * kept. Thread-safe.
+ */
+class PortageMetadataCache
+{
+public:
+    static PortageMetadataCache &instance();
+
+    EbuildMetadata metadata(const QString &repoPath, const QString &atom, const QString &version);
+
+    // All versions of a package in one repository, in ebuild directory order
+    QList<EbuildMetadata> packageMetadata(const QString &repoPath, const QString &atom);
+
+    // Drop everything cached for a package (or all packages of a repository if atom is empty)
+    void invalidate(const QString &repoPath, const QString &atom = QString());
+
+    // Parse md5-cache KEY=value lines, only the values that are used are copied
+    static bool parseCacheEntry(QByteArrayView data, EbuildMetadata &metadata);
+
+    // Read one version without caching it (md5-cache, else the ebuild itself)
+    static EbuildMetadata loadVersion(const QString &repoPath, const QString &atom, const QString &version);
+
+private:
+    PortageMetadataCache();
+
+    struct PackageMetadata {
+        QStringList versions;
+        QHash<QString, EbuildMetadata> byVersion;
+    };
+
+    PackageMetadata package(const QString &repoPath, const QString &atom);
+    static PackageMetadata loadPackage(const QString &repoPath, const QString &atom);
+    static bool readCacheEntry(const QString &path, EbuildMetadata &metadata);
+    static bool parseEbuild(const QString &path, EbuildMetadata &metadata);
+    static QString packageKey(const QString &repoPath, const QString &atom);
+
+    QHash<QString, PackageMetadata> m_packages; // "repoPath|category/package" -> versions
+    quint64 m_epoch = 0;                        // bumped by every invalidate()
+    QReadWriteLock m_lock;
+};
@@ -0,0 +1,179 @@
+/*
+ * SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include "PortageMetadataXml.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QXmlStreamReader>
+
+namespace
+{
+QString elementText(QXmlStreamReader &xml)
+{
+    // Descriptions may contain <pkg>, <b>, ... markup, keep the text only
+    return xml.readElementText(QXmlStreamReader::IncludeChildElements).simplified();
+}
+
+void parseMaintainer(QXmlStreamReader &xml, MetadataXmlRecord &record)
+{
+    MetadataXmlRecord::Maintainer maintainer;
+    while (xml.readNextStartElement()) {
+        if (xml.name() == QLatin1String("email")) {
+            maintainer.email = elementText(xml);
+        } else if (xml.name() == QLatin1String("name")) {
+            maintainer.name = elementText(xml);
+        } else {
+            xml.skipCurrentElement();
+        }
+    }
+    if (!maintainer.name.isEmpty() || !maintainer.email.isEmpty()) {
+        record.maintainers.append(maintainer);
+    }
+}
+
+void parseUpstream(QXmlStreamReader &xml, MetadataXmlRecord &record)
+{
+    while (xml.readNextStartElement()) {
+        if (xml.name() == QLatin1String("bugs-to")) {
+            record.bugsTo = elementText(xml);
+        } else if (xml.name() == QLatin1String("changelog")) {
+            record.changelog = elementText(xml);
+        } else if (xml.name() == QLatin1String("doc")) {
+            record.doc = elementText(xml);
+        } else if (xml.name() == QLatin1String("remote-id")) {
+            const QString type = xml.attributes().value(QLatin1String("type")).toString();
+            record.remoteIds.append(MetadataXmlRecord::RemoteId{type, elementText(xml)});
+        } else {
+            // Upstream maintainers are not package maintainers
+            xml.skipCurrentElement();
+        }
+    }
+}
+}
+
+PortageMetadataXml &PortageMetadataXml::instance()
+{
+    static PortageMetadataXml inst;
+    return inst;
+}
+
+PortageMetadataXml::PortageMetadataXml()
+    : m_cache(MAX_RECORDS)
+{
+    m_pool.setMaxThreadCount(1);
+}
+
+MetadataXmlRecord PortageMetadataXml::parse(QIODevice *device)
+{
+    MetadataXmlRecord record;
+    QXmlStreamReader xml(device);
+
+    while (!xml.atEnd()) {
+        if (xml.readNext() != QXmlStreamReader::StartElement) {
+            continue;
+        }
+        // <pkgmetadata> children, <flag> also appears nested in <use>
+        if (xml.name() == QLatin1String("maintainer")) {
+            parseMaintainer(xml, record);
+        } else if (xml.name() == QLatin1String("upstream")) {
+            parseUpstream(xml, record);
+        } else if (xml.name() == QLatin1String("flag")) {
+            const QString name = xml.attributes().value(QLatin1String("name")).toString();
+            const QString description = elementText(xml);
+            if (!name.isEmpty()) {
+                record.flagDescriptions.insert(name, description);
+            }
+        } else if (xml.name() == QLatin1String("longdescription")) {
+            const QStringView lang = xml.attributes().value(QLatin1String("lang"));
+            const QString text = elementText(xml);
+            if (lang.isEmpty() || lang == QLatin1String("en") || record.longDescription.isEmpty()) {
+                record.longDescription = text;
+            }
+        }
+    }
+
+    if (xml.hasError()) {
+        qDebug() << "PortageMetadataXml: Parse error:" << xml.errorString() << "at line" << xml.lineNumber();
+    }
+    return record;
+}
+
+MetadataXmlRecord PortageMetadataXml::parseFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return MetadataXmlRecord();
+    }
+    return parse(&file);
+}
+
+MetadataXmlRecord PortageMetadataXml::record(const QString &pkgDirPath)
+{
+    if (pkgDirPath.isEmpty()) {
+        return MetadataXmlRecord();
+    }
+
+    {
+        QMutexLocker locker(&m_lock);
+        if (const MetadataXmlRecord *cached = m_cache.object(pkgDirPath)) {
+            return *cached;
+        }
+    }
+
+    // Parse outside the lock, racing the prefetch thread only costs a second parse
+    const MetadataXmlRecord parsed = parseFile(pkgDirPath + QStringLiteral("/metadata.xml"));
+    insert(pkgDirPath, parsed);
+    return parsed;
+}
+
+void PortageMetadataXml::insert(const QString &pkgDirPath, const MetadataXmlRecord &record)
+{
+    QMutexLocker locker(&m_lock);
+    m_cache.insert(pkgDirPath, new MetadataXmlRecord(record));
+}
+
+void PortageMetadataXml::prefetch(const QStringList &pkgDirPaths)
+{
+    QStringList paths;
+    {
+        QMutexLocker locker(&m_lock);
+        for (const QString &path : pkgDirPaths) {
+            if (!path.isEmpty() && !m_cache.contains(path) && !m_queued.contains(path)) {
+                m_queued.insert(path);
+                paths << path;
+            }
+        }
+    }
+    if (paths.isEmpty()) {
+        return;
+    }
+
+    m_pool.start([this, paths]() {
+        for (const QString &path : paths) {
+            {
+                QMutexLocker locker(&m_lock);
+                m_queued.remove(path);
+                if (m_cache.contains(path)) {
+                    continue;
+                }
+            }
+            insert(path, parseFile(path + QStringLiteral("/metadata.xml")));
+        }
+    });
+}
+
+void PortageMetadataXml::invalidate(const QString &repoPath)
+{
+    const QString prefix = repoPath + QLatin1Char('/');
+
+    QMutexLocker locker(&m_lock);
+    const QList<QString> keys = m_cache.keys();
+    for (const QString &key : keys) {
+        if (key.startsWith(prefix)) {
+            m_cache.remove(key);
+        }
+    }
+}
@@ -0,0 +1,82 @@
+/*
+ * SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#pragma once
+
+#include <QCache>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+
+class QIODevice;
+
+/**
+ * @brief The parts of a package's metadata.xml that are shown or searched
+ */
+struct MetadataXmlRecord {
+    struct Maintainer {
+        QString name;
+        QString email;
+    };
+
+    struct RemoteId {
+        QString type; // github, pypi, ...
+        QString id;
+    };
+
+    QList<Maintainer> maintainers;
+    QMap<QString, QString> flagDescriptions; // flag name -> description, markup flattened
+    QString longDescription;                 // English or untagged one
+
+    // <upstream>
+    QString bugsTo;
+    QString changelog;
+    QString doc;
+    QList<RemoteId> remoteIds;
+};
+
+/**
+ * @brief Process-wide metadata.xml parser and cache
+ *
+ * One streaming pass (QXmlStreamReader) fills a MetadataXmlRecord. Records
+ * are kept in a bounded LRU cache keyed by package directory, so the
+ * package page and the USE flags dialog share one parse. prefetch() parses
+ * records for packages that were just shown in search results on a
+ * single background thread, before anybody opens them. Thread-safe.
+ */
+class PortageMetadataXml
+{
+public:
+    static PortageMetadataXml &instance();
+
+    // Record of <pkgDirPath>/metadata.xml, empty if there is none
+    MetadataXmlRecord record(const QString &pkgDirPath);
+
+    // Parse these package directories in the background, cached ones are skipped
+    void prefetch(const QStringList &pkgDirPaths);
+
+    // Drop cached records below a repository after it changed
+    void invalidate(const QString &repoPath);
+
+    // Uncached parse, for bulk readers that would only churn the cache
+    static MetadataXmlRecord parseFile(const QString &path);
+    static MetadataXmlRecord parse(QIODevice *device);
+
+private:
+    PortageMetadataXml();
+
+    void insert(const QString &pkgDirPath, const MetadataXmlRecord &record);
+
+    static constexpr int MAX_RECORDS = 2000;
+
+    QCache<QString, MetadataXmlRecord> m_cache;
+    QSet<QString> m_queued; // waiting for the prefetch thread
+    QMutex m_lock;
+    QThreadPool m_pool; // last, so pending prefetches finish before the cache goes away
+};
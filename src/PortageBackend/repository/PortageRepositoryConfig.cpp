@@ -14,6 +14,8 @@
 #include <QSettings>
 #include <QTemporaryFile>
 
+#include <algorithm>
+
 PortageRepositoryConfig& PortageRepositoryConfig::instance()
 {
     static PortageRepositoryConfig inst;
@@ -27,38 +29,57 @@ PortageRepositoryConfig::PortageRepositoryConfig()
 
 void PortageRepositoryConfig::reload()
 {
-    m_repositories.clear();
+    // Parsed outside the lock, lookups keep using the previous configuration meanwhile
+    QMap<QString, Repository> repositories;
     
     // Try portageq first (most reliable)
-    parseFromPortageq();
+    parseFromPortageq(repositories);
     
     // Fallback to repos.conf if portageq didn't return anything
-    if (m_repositories.isEmpty()) {
-        parseFromReposConf();
+    if (repositories.isEmpty()) {
+        parseFromReposConf(repositories);
     }
     
-    qDebug() << "PortageRepositoryConfig: Loaded" << m_repositories.size() << "repositories";
+    qDebug() << "PortageRepositoryConfig: Loaded" << repositories.size() << "repositories";
+    
+    QWriteLocker locker(&m_lock);
+    m_repositories = repositories;
 }
 
 QString PortageRepositoryConfig::getRepositoryLocation(const QString &name) const
 {
-    if (m_repositories.contains(name)) {
-        return m_repositories.value(name).location;
-    }
-    return QString();
+    QReadLocker locker(&m_lock);
+    const auto it = m_repositories.constFind(name);
+    return it != m_repositories.constEnd() ? it->location : QString();
 }
 
 QStringList PortageRepositoryConfig::getAllRepositoryNames() const
 {
-    return m_repositories.keys();
+    // Highest priority first, like Portage picks between equal versions; ties by name
+    QList<Repository> repos;
+    {
+        QReadLocker locker(&m_lock);
+        repos = m_repositories.values();
+    }
+    std::stable_sort(repos.begin(), repos.end(), [](const Repository &a, const Repository &b) {
+        return a.priority > b.priority;
+    });
+    
+    QStringList names;
+    names.reserve(repos.size());
+    for (const Repository &repo : std::as_const(repos)) {
+        names << repo.name;
+    }
+    return names;
 }
 
 PortageRepositoryConfig::Repository PortageRepositoryConfig::getRepository(const QString &name) const
 {
+    QReadLocker locker(&m_lock);
     return m_repositories.value(name);
 }
 
-void PortageRepositoryConfig::parseFromPortageq()
+void PortageRepositoryConfig::parseFromPortageq(QMap<QString, Repository> &repositories)
 {
     QProcess proc;
     proc.start(QStringLiteral("portageq"), QStringList{QStringLiteral("repositories_configuration"), QStringLiteral("/")});
@@ -88,12 +109,12 @@ void PortageRepositoryConfig::parseFromPortageq()
     tempFile.flush();
     
     QSettings settings(tempFile.fileName(), QSettings::IniFormat);
-    parseRepositoriesFromSettings(settings);
+    parseRepositoriesFromSettings(settings, repositories);
     
-    qDebug() << "PortageRepositoryConfig: Parsed" << m_repositories.size() << "repositories from portageq";
+    qDebug() << "PortageRepositoryConfig: Parsed" << repositories.size() << "repositories from portageq";
 }
 
-void PortageRepositoryConfig::parseFromReposConf()
+void PortageRepositoryConfig::parseFromReposConf(QMap<QString, Repository> &repositories)
 {
     const QString reposConfPath = QStringLiteral("/etc/portage/repos.conf");
     QFileInfo fi(reposConfPath);
@@ -106,7 +127,7 @@ void PortageRepositoryConfig::parseFromReposConf()
     // QSettings can read single file or we need to merge directory
     if (fi.isFile()) {
         QSettings settings(reposConfPath, QSettings::IniFormat);
-        parseRepositoriesFromSettings(settings);
+        parseRepositoriesFromSettings(settings, repositories);
     } else if (fi.isDir()) {
         // Merge all .conf files from directory
         QString combined;
@@ -126,15 +147,15 @@ void PortageRepositoryConfig::parseFromReposConf()
                 tempFile.flush();
                 
                 QSettings settings(tempFile.fileName(), QSettings::IniFormat);
-                parseRepositoriesFromSettings(settings);
+                parseRepositoriesFromSettings(settings, repositories);
             }
         }
     }
     
-    qDebug() << "PortageRepositoryConfig: Parsed" << m_repositories.size() << "repositories from repos.conf";
+    qDebug() << "PortageRepositoryConfig: Parsed" << repositories.size() << "repositories from repos.conf";
 }
 
-void PortageRepositoryConfig::parseRepositoriesFromSettings(QSettings &settings)
+void PortageRepositoryConfig::parseRepositoriesFromSettings(QSettings &settings, QMap<QString, Repository> &repositories)
 {
     const QStringList groups = settings.childGroups();
     for (const QString &name : groups) {
@@ -155,7 +176,7 @@ void PortageRepositoryConfig::parseRepositoriesFromSettings(QSettings &settings)
         settings.endGroup();
         
         if (!repo.location.isEmpty()) {
-            m_repositories.insert(name, repo);
+            repositories.insert(name, repo);
         }
     }
 }
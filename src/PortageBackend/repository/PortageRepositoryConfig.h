@@ -6,6 +6,7 @@
 #pragma once
 
 #include <QMap>
+#include <QReadWriteLock>
 #include <QString>
 #include <QStringList>
 
@@ -15,6 +16,9 @@
  * Parses repository configuration from:
  * 1. portageq repositories_configuration /
  * 2. /etc/portage/repos.conf (file or directory)
+ *
+ * reload() parses into a new map and swaps it in under a write lock, so
+ * lookups from worker threads never see a half-built configuration.
  */
 class PortageRepositoryConfig
 {
@@ -33,15 +37,16 @@ public:
     void reload();
     
     QString getRepositoryLocation(const QString &name) const;
-    QStringList getAllRepositoryNames() const;
+    QStringList getAllRepositoryNames() const; // highest priority first
     Repository getRepository(const QString &name) const;
     
 private:
     PortageRepositoryConfig();
     
     QMap<QString, Repository> m_repositories;
+    mutable QReadWriteLock m_lock;
     
-    void parseFromPortageq();
-    void parseFromReposConf();
-    void parseRepositoriesFromSettings(class QSettings &settings);
+    static void parseFromPortageq(QMap<QString, Repository> &repositories);
+    static void parseFromReposConf(QMap<QString, Repository> &repositories);
+    static void parseRepositoriesFromSettings(class QSettings &settings, QMap<QString, Repository> &repositories);
 };
@@ -0,0 +1,92 @@
+/*
+ * SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include "PortageRepositoryIndex.h"
+#include "PortageRepositoryConfig.h"
+
+#include <QDebug>
+
+PortageRepositoryIndex &PortageRepositoryIndex::instance()
+{
+    static PortageRepositoryIndex inst;
+    return inst;
+}
+
+PortageRepositoryIndex::PortageRepositoryIndex()
+{
+}
+
+void PortageRepositoryIndex::setRepositoryAtoms(const QHash<QString, QStringList> &repoAtoms)
+{
+    const PortageRepositoryConfig &config = PortageRepositoryConfig::instance();
+
+    // Built outside the lock, lookups keep using the previous index meanwhile
+    QList<Repository> repositories;
+    QHash<QString, QList<quint16>> atoms;
+    const QStringList names = config.getAllRepositoryNames();
+    for (const QString &name : names) {
+        const auto it = repoAtoms.constFind(name);
+        if (it == repoAtoms.constEnd()) {
+            continue;
+        }
+        const quint16 repoIndex = quint16(repositories.size());
+        const PortageRepositoryConfig::Repository repo = config.getRepository(name);
+        repositories.append(Repository{name, repo.location, repo.priority});
+
+        // Repositories are visited in priority order, so every list stays sorted
+        atoms.reserve(atoms.size() + it.value().size());
+        for (const QString &atom : it.value()) {
+            atoms[atom].append(repoIndex);
+        }
+    }
+
+    qDebug() << "PortageRepositoryIndex: Indexed" << atoms.size() << "atoms in" << repositories.size() << "repositories";
+
+    QWriteLocker locker(&m_lock);
+    m_repositories = repositories;
+    m_atoms = atoms;
+    m_populated = true;
+}
+
+bool PortageRepositoryIndex::isPopulated() const
+{
+    QReadLocker locker(&m_lock);
+    return m_populated;
+}
+
+RepositoryLocation PortageRepositoryIndex::makeLocation(const QString &atom, quint16 repoIndex) const
+{
+    const Repository &repo = m_repositories.at(repoIndex);
+    return RepositoryLocation{repo.name, repo.location + QLatin1Char('/') + atom, repo.priority};
+}
+
+QList<RepositoryLocation> PortageRepositoryIndex::locations(const QString &atom) const
+{
+    QReadLocker locker(&m_lock);
+
+    QList<RepositoryLocation> result;
+    const QList<quint16> repoIndexes = m_atoms.value(atom);
+    result.reserve(repoIndexes.size());
+    for (quint16 repoIndex : repoIndexes) {
+        result << makeLocation(atom, repoIndex);
+    }
+    return result;
+}
+
+RepositoryLocation PortageRepositoryIndex::location(const QString &atom, const QString &repository) const
+{
+    QReadLocker locker(&m_lock);
+
+    const auto it = m_atoms.constFind(atom);
+    if (it == m_atoms.constEnd()) {
+        return RepositoryLocation();
+    }
+    for (quint16 repoIndex : it.value()) {
+        if (repository.isEmpty() || m_repositories.at(repoIndex).name == repository) {
+            return makeLocation(atom, repoIndex);
+        }
+    }
+    return RepositoryLocation();
+}
@@ -0,0 +1,67 @@
+/*
+ * SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QReadWriteLock>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief Where a package lives in one repository
+ */
+struct RepositoryLocation {
+    QString repository;
+    QString path; // <repository location>/<category>/<package>
+    int priority = 0;
+
+    bool isValid() const { return !repository.isEmpty(); }
+};
+
+/**
+ * @brief Process-wide atom -> repositories index
+ *
+ * Filled from the repository scan (or the catalog snapshot) and replaced
+ * after every reload, so finding the repository or directory of a package
+ * is a hash probe instead of a stat per configured repository. An atom
+ * found in several repositories lists them by priority, highest first,
+ * the same order PortageRepositoryConfig::getAllRepositoryNames() uses.
+ *
+ * Until the first scan has been published, isPopulated() is false and
+ * callers fall back to probing the filesystem. Thread-safe.
+ */
+class PortageRepositoryIndex
+{
+public:
+    static PortageRepositoryIndex &instance();
+
+    // Replace the index: repository -> every atom it has
+    void setRepositoryAtoms(const QHash<QString, QStringList> &repoAtoms);
+    bool isPopulated() const;
+
+    // Every repository providing the atom, highest priority first
+    QList<RepositoryLocation> locations(const QString &atom) const;
+
+    // The highest priority one, or the given repository's; invalid if not there
+    RepositoryLocation location(const QString &atom, const QString &repository = QString()) const;
+
+private:
+    PortageRepositoryIndex();
+
+    struct Repository {
+        QString name;
+        QString location;
+        int priority;
+    };
+
+    RepositoryLocation makeLocation(const QString &atom, quint16 repoIndex) const;
+
+    QList<Repository> m_repositories;        // priority order
+    QHash<QString, QList<quint16>> m_atoms;   // atom -> m_repositories indexes, ascending
+    bool m_populated = false;
+    mutable QReadWriteLock m_lock;
+};
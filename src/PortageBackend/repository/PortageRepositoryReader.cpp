@@ -5,74 +5,212 @@
 
 #include "PortageRepositoryReader.h"
 #include "PortageRepositoryConfig.h"
+#include "PortageRepositoryIndex.h"
+#include "PortageVersionIndex.h"
 #include "../backend/PortageBackend.h"
-#include "../resources/PortageResource.h"
-#include "../utils/AtomParser.h"
+#include "../utils/FsUtils.h"
+#include "../utils/PortageVersion.h"
+#include "../utils/StringUtils.h"
 
 #include <QDir>
 #include <QDebug>
+#include <QFile>
+#include <QFutureWatcher>
+#include <QSet>
+#include <QtConcurrent>
+
+#include <unistd.h>
 
 PortageRepositoryReader::PortageRepositoryReader(PortageBackend *backend, QObject *parent)
     : QObject(parent)
     , m_backend(backend)
-    , m_repoPath()
 {
-    // Reload config on init
-    PortageRepositoryConfig::instance().reload();
 }
 
-void PortageRepositoryReader::loadRepository()
+PortageRepositoryReader::~PortageRepositoryReader()
 {
-    const QStringList allRepos = PortageRepositoryConfig::instance().getAllRepositoryNames();
-    qDebug() << "Portage: RepositoryReader loading from" << allRepos.size() << "repositories";
+    // Workers use the repository descriptors, don't close them under their feet
+    if (m_watcher) {
+        m_watcher->cancel();
+        m_watcher->waitForFinished();
+    }
+    closeRepositories();
+}
+
+void PortageRepositoryReader::loadRepository(const QStringList &repositories)
+{
+    m_timer.start();
+
+    const QList<CategoryJob> jobs = openRepositories(repositories);
+
+    // Every job returns its own list, so workers never share state
+    const QList<QList<RepositoryPackageEntry>> results =
+        QtConcurrent::blockingMapped<QList<QList<RepositoryPackageEntry>>>(jobs, &PortageRepositoryReader::scanCategory);
+    closeRepositories();
 
-    if (allRepos.isEmpty()) {
-        qDebug() << "Portage: no repositories found in configuration";
-        Q_EMIT packagesLoaded(0);
-        return;
+    for (const QList<RepositoryPackageEntry> &categoryEntries : results) {
+        mergeEntries(categoryEntries);
     }
 
-    // Iterate over all configured repositories
-    for (const QString &repoName : allRepos) {
+    qDebug() << "Portage: RepositoryReader found" << m_packages.size() << "packages in" << jobs.size()
+             << "categories," << m_timer.elapsed() << "ms";
+    Q_EMIT packagesLoaded(m_packages.size());
+}
+
+void PortageRepositoryReader::loadRepositoryAsync()
+{
+    m_timer.start();
+    const QList<CategoryJob> jobs = openRepositories();
+    const int total = jobs.size();
+    m_jobsDone = 0;
+
+    m_watcher = new QFutureWatcher<QList<RepositoryPackageEntry>>(this);
+    connect(m_watcher, &QFutureWatcherBase::resultReadyAt, this, [this, total](int index) {
+        const QList<RepositoryPackageEntry> accepted = mergeEntries(m_watcher->resultAt(index));
+        if (!accepted.isEmpty()) {
+            Q_EMIT packagesFound(accepted);
+        }
+        Q_EMIT progressChanged(++m_jobsDone, total);
+    });
+    connect(m_watcher, &QFutureWatcherBase::finished, this, [this, total]() {
+        closeRepositories();
+        m_watcher->deleteLater();
+        m_watcher = nullptr;
+        qDebug() << "Portage: RepositoryReader found" << m_packages.size() << "packages in" << total
+                 << "categories," << m_timer.elapsed() << "ms";
+        Q_EMIT packagesLoaded(m_packages.size());
+    });
+
+    m_watcher->setFuture(QtConcurrent::mapped(jobs, &PortageRepositoryReader::scanCategory));
+}
+
+QList<PortageRepositoryReader::CategoryJob> PortageRepositoryReader::openRepositories(const QStringList &repositories)
+{
+    const QStringList allRepos = PortageRepositoryConfig::instance().getAllRepositoryNames();
+    qDebug() << "Portage: RepositoryReader loading from"
+             << (repositories.isEmpty() ? allRepos.size() : repositories.size()) << "repositories";
+
+    // One job per (repository, category). Repositories keep their
+    // configuration order so the first one providing an atom wins on merge
+    QList<CategoryJob> jobs;
+    for (int rank = 0; rank < allRepos.size(); ++rank) {
+        const QString &repoName = allRepos.at(rank);
+        m_repoRank.insert(repoName, rank);
+        if (!repositories.isEmpty() && !repositories.contains(repoName)) {
+            continue;
+        }
+        
         const QString repoPath = PortageRepositoryConfig::instance().getRepositoryLocation(repoName);
-        if (!repoPath.isEmpty() && QDir(repoPath).exists()) {
-            scanRepositoryPath(repoPath);
-        } else {
+        const int repoFd = repoPath.isEmpty() ? -1 : FsUtils::openDirectory(repoPath);
+        if (repoFd < 0) {
             qDebug() << "Portage: Repository" << repoName << "path not found:" << repoPath;
+            continue;
+        }
+        m_repoFds << repoFd;
+        m_repoAtoms.insert(repoName, QStringList());
+
+        const QStringList categories = readCategories(repoPath, repoFd);
+        for (const QString &category : categories) {
+            jobs << CategoryJob{repoName, repoFd, category};
         }
     }
+    return jobs;
+}
 
-    qDebug() << "Portage: RepositoryReader found" << m_packages.size() << "packages (scan only)";
-    Q_EMIT packagesLoaded(m_packages.size());
+void PortageRepositoryReader::closeRepositories()
+{
+    for (int fd : std::as_const(m_repoFds)) {
+        ::close(fd);
+    }
+    m_repoFds.clear();
 }
 
-void PortageRepositoryReader::scanRepositoryPath(const QString &path)
+QList<RepositoryPackageEntry> PortageRepositoryReader::mergeEntries(const QList<RepositoryPackageEntry> &entries)
 {
-    QDir repo(path);
-    const QString repoName = QFileInfo(path).fileName();
-    
-    const QFileInfoList categories = repo.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
-    for (const QFileInfo &catInfo : categories) {
-        const QString catPath = catInfo.absoluteFilePath();
-        const QString category = catInfo.fileName();
-        QDir catDir(catPath);
-        const QFileInfoList packages = catDir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
-        for (const QFileInfo &pkgInfo : packages) {
-            const QString pkg = pkgInfo.fileName();
-            const QString atom = category + QLatin1Char('/') + pkg;
-            if (m_packages.contains(atom))
-                continue;
-            
-            PortageResource *res = new PortageResource(atom, pkg, QString(), m_backend);
-            res->setRepository(repoName);
-            
-            // Don't load versions here
-            // Versions will be loaded lazily when user opens package page
-            // TODO: Add versions caching mechanism if needed
-            
-            m_packages.insert(atom, res);
+    QList<RepositoryPackageEntry> accepted;
+    for (const RepositoryPackageEntry &entry : entries) {
+        m_repoAtoms[entry.repository] << entry.atom;
+        
+        auto existing = m_packages.find(entry.atom);
+        if (existing == m_packages.end()) {
+            m_packages.insert(entry.atom, entry);
+            accepted << entry;
+        } else if (m_repoRank.value(entry.repository) < m_repoRank.value(existing->repository)) {
+            // Results arrive out of order in async mode
+            *existing = entry;
+            accepted << entry;
         }
     }
+    return accepted;
+}
+
+QHash<QString, RepositoryPackageEntry> PortageRepositoryReader::resolvePackages(const QHash<QString, QStringList> &repoAtoms)
+{
+    QHash<QString, RepositoryPackageEntry> packages;
+    const QStringList allRepos = PortageRepositoryConfig::instance().getAllRepositoryNames();
+    for (const QString &repoName : allRepos) {
+        const QStringList atoms = repoAtoms.value(repoName);
+        for (const QString &atom : atoms) {
+            if (!packages.contains(atom)) {
+                packages.insert(atom, RepositoryPackageEntry{atom, repoName});
+            }
+        }
+    }
+    return packages;
+}
+
+QStringList PortageRepositoryReader::readCategories(const QString &repoPath, int repoFd)
+{
+    QStringList categories;
+
+    QFile file(repoPath + QStringLiteral("/profiles/categories"));
+    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        const QList<QByteArray> lines = file.readAll().split('\n');
+        for (const QByteArray &line : lines) {
+            const QString category = QString::fromUtf8(line).trimmed();
+            if (!StringUtils::isCommentOrEmptyTrimmed(category)) {
+                categories << category;
+            }
+        }
+        return categories;
+    }
+
+    // Overlays without profiles/categories: everything that isn't repository metadata
+    static const QSet<QString> nonCategories = {
+        QStringLiteral("eclass"),
+        QStringLiteral("licenses"),
+        QStringLiteral("metadata"),
+        QStringLiteral("profiles"),
+        QStringLiteral("scripts"),
+    };
+    const QStringList dirs = FsUtils::listDirectory(repoFd, FsUtils::EntryType::Directories);
+    for (const QString &dir : dirs) {
+        if (!nonCategories.contains(dir)) {
+            categories << dir;
+        }
+    }
+    return categories;
+}
+
+QList<RepositoryPackageEntry> PortageRepositoryReader::scanCategory(const CategoryJob &job)
+{
+    QList<RepositoryPackageEntry> entries;
+
+    const int catFd = FsUtils::openDirectoryAt(job.repoFd, job.category);
+    if (catFd < 0) {
+        // Listed in profiles/categories but not present in this repository
+        return entries;
+    }
+
+    const QStringList packages = FsUtils::listDirectory(catFd, FsUtils::EntryType::Directories);
+    ::close(catFd);
+
+    entries.reserve(packages.size());
+    for (const QString &pkg : packages) {
+        // Versions are listed by PortageVersionIndex when somebody asks for them
+        entries << RepositoryPackageEntry{job.category + QLatin1Char('/') + pkg, job.repository};
+    }
+    return entries;
 }
 
 QStringList PortageRepositoryReader::findAvailableVersions(const QString &pkgPath, const QString &pkgName)
@@ -92,9 +230,8 @@ QStringList PortageRepositoryReader::findAvailableVersions(const QString &pkgPat
         }
     }
 
-    // Sort descending (latest first)
-    std::sort(versions.begin(), versions.end(), std::greater<QString>());
-    versions.erase(std::unique(versions.begin(), versions.end()), versions.end());
+    // Latest first, in PMS order (1.10 > 1.9, 1.0 > 1.0_rc1)
+    PortageVersion::sortDescending(versions);
     return versions;
 }
 
@@ -107,6 +244,12 @@ QStringList PortageRepositoryReader::getAllRepositories()
 // Static helper: Find which repository contains a package
 QString PortageRepositoryReader::findPackageRepository(const QString &atom)
 {
+    const PortageRepositoryIndex &index = PortageRepositoryIndex::instance();
+    if (index.isPopulated()) {
+        return index.location(atom).repository;
+    }
+    
+    // Before the first scan has been published
     const QStringList repos = PortageRepositoryConfig::instance().getAllRepositoryNames();
     for (const QString &repo : repos) {
         const QString repoPath = PortageRepositoryConfig::instance().getRepositoryLocation(repo);
@@ -122,6 +265,11 @@ QString PortageRepositoryReader::findPackageRepository(const QString &atom)
 // Static helper: Get full path to package in repository
 QString PortageRepositoryReader::findPackagePath(const QString &atom, const QString &repository)
 {
+    const PortageRepositoryIndex &index = PortageRepositoryIndex::instance();
+    if (index.isPopulated()) {
+        return index.location(atom, repository).path;
+    }
+    
     QString repo = repository;
     
     // If no repository specified, find it
@@ -154,32 +302,13 @@ bool PortageRepositoryReader::packageExistsInRepo(const QString &atom, const QSt
 // Static helper: Get available versions for a package
 QStringList PortageRepositoryReader::getAvailableVersions(const QString &atom, const QString &repository)
 {
-    QString pkgPath = findPackagePath(atom, repository);
-    if (pkgPath.isEmpty()) {
+    const QString repo = repository.isEmpty() ? findPackageRepository(atom) : repository;
+    if (repo.isEmpty()) {
         return QStringList();
     }
     
-    QString pkgName = AtomParser::extractPackageName(atom);
-    
-    QDir pkgDir(pkgPath);
-    QStringList ebuilds = pkgDir.entryList(QStringList() << QStringLiteral("*.ebuild"), QDir::Files, QDir::Name);
-    
-    QStringList versions;
-    for (const QString &ebuild : ebuilds) {
-        QString version = ebuild;
-        version.remove(0, pkgName.length() + 1);
-        if (version.endsWith(QLatin1String(".ebuild"))) {
-            version.chop(7);
-        }
-        if (!version.isEmpty()) {
-            versions << version;
-        }
-    }
-    
-    // Sort descending (latest first)
-    std::sort(versions.begin(), versions.end(), std::greater<QString>());
-    versions.erase(std::unique(versions.begin(), versions.end()), versions.end());
-    
-    return versions;
+    // Served from listings cached per category, no directory walk per call
+    const QString repoPath = PortageRepositoryConfig::instance().getRepositoryLocation(repo);
+    return PortageVersionIndex::instance().versions(repoPath, atom);
 }
 
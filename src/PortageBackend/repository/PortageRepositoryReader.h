@@ -6,24 +6,48 @@
 #pragma once
 
 #include <QObject>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
 #include <QHash>
+#include <QList>
 
 class PortageBackend;
-class PortageResource;
+
+struct RepositoryPackageEntry {
+    QString atom;
+    QString repository;
+};
 
 class PortageRepositoryReader : public QObject
 {
     Q_OBJECT
 public:
     explicit PortageRepositoryReader(PortageBackend *backend, QObject *parent = nullptr);
+    ~PortageRepositoryReader() override;
 
     /**
-     * Load repository package list from disk (synchronous, simple parsing)
-     * # TODO: implement actual parsing of ebuilds to get versions, use flags, etc.
+     * Load repository package list from disk. Categories come from each
+     * repository's profiles/categories and are scanned in parallel on the
+     * global thread pool, the caller blocks until all of them are done.
+     * Only the given repositories are scanned when the list isn't empty.
+     * Versions come from PortageVersionIndex and ebuild metadata from
+     * PortageMetadataCache, both on first access.
      */
-    void loadRepository();
+    void loadRepository(const QStringList &repositories = QStringList());
 
-    QHash<QString, PortageResource *> packages() const { return m_packages; }
+    /**
+     * Same as loadRepository() but returns immediately. packagesFound() is
+     * emitted as categories finish, packagesLoaded() once all are merged.
+     */
+    void loadRepositoryAsync();
+
+    QHash<QString, RepositoryPackageEntry> packages() const { return m_packages; }
+    
+    // Every atom found per repository, including ones shadowed by an earlier repository
+    QHash<QString, QStringList> repositoryAtoms() const { return m_repoAtoms; }
+    
+    // Resolve atom -> providing repository, the first repository in configuration order wins
+    static QHash<QString, RepositoryPackageEntry> resolvePackages(const QHash<QString, QStringList> &repoAtoms);
     
     // Static helper methods for repository operations
     static QString findPackageRepository(const QString &atom);
@@ -31,18 +55,38 @@ public:
     static QStringList getAvailableVersions(const QString &atom, const QString &repository = QString());
     static bool packageExistsInRepo(const QString &atom, const QString &repository = QString());
     static QStringList getAllRepositories();
-
-private:
-    QStringList findAvailableVersions(const QString &pkgPath, const QString &pkgName);
+    
+    // Versions of the ebuilds in a package directory, newest first
+    static QStringList findAvailableVersions(const QString &pkgPath, const QString &pkgName);
+    
+    // Categories of a repository: profiles/categories, or its directories for overlays without one
+    static QStringList readCategories(const QString &repoPath, int repoFd);
 
 Q_SIGNALS:
     void packagesLoaded(int count);
+    // Entries that were added, or moved to a repository listed earlier
+    void packagesFound(const QList<RepositoryPackageEntry> &entries);
+    void progressChanged(int done, int total);
 
 private:
-    void scanRepositoryPath(const QString &path);
-    QString findLatestVersion(const QString &pkgPath, const QString &pkgName);
+    struct CategoryJob {
+        QString repository;
+        int repoFd;
+        QString category;
+    };
+
+    QList<CategoryJob> openRepositories(const QStringList &repositories = QStringList());
+    void closeRepositories();
+    QList<RepositoryPackageEntry> mergeEntries(const QList<RepositoryPackageEntry> &entries);
+
+    static QList<RepositoryPackageEntry> scanCategory(const CategoryJob &job);
 
     PortageBackend *m_backend;
-    QHash<QString, PortageResource *> m_packages;
-    QString m_repoPath;
+    QHash<QString, RepositoryPackageEntry> m_packages;
+    QHash<QString, QStringList> m_repoAtoms;
+    QHash<QString, int> m_repoRank; // repository -> position in configuration order
+    QList<int> m_repoFds;
+    QFutureWatcher<QList<RepositoryPackageEntry>> *m_watcher = nullptr;
+    QElapsedTimer m_timer;
+    int m_jobsDone = 0;
 };
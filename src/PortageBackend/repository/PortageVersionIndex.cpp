@@ -0,0 +1,128 @@
+/*
+ * SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include "PortageVersionIndex.h"
+#include "PortageRepositoryReader.h"
+#include "../utils/FsUtils.h"
+#include "../utils/PortageVersion.h"
+
+#include <QDeadlineTimer>
+#include <QFile>
+
+#include <sys/stat.h>
+
+PortageVersionIndex &PortageVersionIndex::instance()
+{
+    static PortageVersionIndex inst;
+    return inst;
+}
+
+PortageVersionIndex::PortageVersionIndex()
+{
+}
+
+qint64 PortageVersionIndex::directoryStamp(const QString &path)
+{
+    struct stat st;
+    if (::stat(QFile::encodeName(path).constData(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+        return -1;
+    }
+    return qint64(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+QStringList PortageVersionIndex::versions(const QString &repoPath, const QString &atom)
+{
+    const qsizetype slash = atom.indexOf(QLatin1Char('/'));
+    if (repoPath.isEmpty() || slash <= 0) {
+        return QStringList();
+    }
+    const QString category = atom.left(slash);
+    const QString pkgName = atom.mid(slash + 1);
+
+    // Synced repositories: one listing serves the whole category
+    const Listing cached = listing(m_cacheCategories, repoPath + QLatin1Char('|') + category,
+                                   repoPath + QStringLiteral("/metadata/md5-cache/") + category, &listCacheCategory);
+    if (cached.stamp >= 0 && cached.versions.contains(pkgName)) {
+        return cached.versions.value(pkgName);
+    }
+
+    // No metadata cache (most overlays) or none for this package yet, list the ebuilds themselves
+    const Listing ebuilds = listing(m_packages, repoPath + QLatin1Char('|') + atom, repoPath + QLatin1Char('/') + atom,
+                                    [&pkgName](const QString &dirPath) {
+                                        Listing result;
+                                        result.versions.insert(pkgName, PortageRepositoryReader::findAvailableVersions(dirPath, pkgName));
+                                        return result;
+                                    });
+    return ebuilds.versions.value(pkgName);
+}
+
+PortageVersionIndex::Listing PortageVersionIndex::listing(QHash<QString, Listing> &table,
+                                                          const QString &key,
+                                                          const QString &dirPath,
+                                                          const Builder &build)
+{
+    const qint64 now = QDeadlineTimer::current().deadline();
+    {
+        QReadLocker locker(&m_lock);
+        const auto it = table.constFind(key);
+        if (it != table.constEnd() && now - it->checkedAt < RECHECK_INTERVAL_MS) {
+            return it.value();
+        }
+    }
+
+    const qint64 stamp = directoryStamp(dirPath);
+    {
+        QWriteLocker locker(&m_lock);
+        const auto it = table.find(key);
+        if (it != table.end() && it->stamp == stamp) {
+            it->checkedAt = now;
+            return it.value();
+        }
+    }
+
+    // Listed after the stamp was taken: a change in between only causes one more listing later
+    Listing result = stamp >= 0 ? build(dirPath) : Listing();
+    result.stamp = stamp;
+    result.checkedAt = now;
+
+    QWriteLocker locker(&m_lock);
+    table.insert(key, result);
+    return result;
+}
+
+PortageVersionIndex::Listing PortageVersionIndex::listCacheCategory(const QString &dirPath)
+{
+    Listing result;
+
+    // Entries are named <package>-<version>; a package name never ends in
+    // something that looks like a version, so the first such split is right
+    const QStringList entries = FsUtils::listDirectory(dirPath, FsUtils::EntryType::Files);
+    for (const QString &entry : entries) {
+        for (qsizetype dash = entry.indexOf(QLatin1Char('-')); dash > 0; dash = entry.indexOf(QLatin1Char('-'), dash + 1)) {
+            if (dash + 1 < entry.size() && entry.at(dash + 1).isDigit()
+                && PortageVersion::isValid(QStringView(entry).sliced(dash + 1))) {
+                result.versions[entry.left(dash)] << entry.mid(dash + 1);
+                break;
+            }
+        }
+    }
+
+    for (QStringList &versions : result.versions) {
+        PortageVersion::sortDescending(versions);
+    }
+    return result;
+}
+
+void PortageVersionIndex::invalidate(const QString &repoPath)
+{
+    const QString prefix = repoPath + QLatin1Char('|');
+
+    QWriteLocker locker(&m_lock);
+    const auto byPrefix = [&prefix](const QHash<QString, Listing>::iterator &it) {
+        return it.key().startsWith(prefix);
+    };
+    m_cacheCategories.removeIf(byPrefix);
+    m_packages.removeIf(byPrefix);
+}
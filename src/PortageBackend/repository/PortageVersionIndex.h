@@ -0,0 +1,57 @@
+/*
+ * SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#pragma once
+
+#include <QHash>
+#include <QReadWriteLock>
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+
+/**
+ * @brief Process-wide cache of the versions each repository package has
+ *
+ * Repositories with a metadata cache are read one category at a time: a
+ * single listing of metadata/md5-cache/<category> yields the versions of
+ * every package in it. Other repositories are listed per package
+ * directory. Each listing remembers the mtime of the directory it came
+ * from and is re-read once that changes; the mtime itself is checked at
+ * most once a second, so scrolling through a category costs a few hash
+ * lookups per row. Thread-safe.
+ */
+class PortageVersionIndex
+{
+public:
+    static PortageVersionIndex &instance();
+
+    // Versions of a package in one repository, newest first
+    QStringList versions(const QString &repoPath, const QString &atom);
+
+    // Forget every listing of a repository
+    void invalidate(const QString &repoPath);
+
+private:
+    PortageVersionIndex();
+
+    struct Listing {
+        qint64 stamp = -1;    // mtime (ns) of the listed directory, -1 if it doesn't exist
+        qint64 checkedAt = 0; // when the stamp was last compared, steady clock ms
+        QHash<QString, QStringList> versions; // package name -> versions, newest first
+    };
+
+    using Builder = std::function<Listing(const QString &dirPath)>;
+    Listing listing(QHash<QString, Listing> &table, const QString &key, const QString &dirPath, const Builder &build);
+
+    static Listing listCacheCategory(const QString &dirPath);
+    static qint64 directoryStamp(const QString &path);
+
+    static constexpr qint64 RECHECK_INTERVAL_MS = 1000;
+
+    QHash<QString, Listing> m_cacheCategories; // "repoPath|category" -> md5-cache listing
+    QHash<QString, Listing> m_packages;        // "repoPath|atom" -> ebuild listing
+    QReadWriteLock m_lock;
+};
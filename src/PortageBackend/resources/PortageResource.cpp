@@ -10,11 +10,12 @@
 #include "../config/MakeConfReader.h"
 #include "../repository/PortageRepositoryConfig.h"
 #include "../repository/PortageRepositoryReader.h"
+#include "../repository/PortageMetadataCache.h"
+#include "../installed/PortageInstalledReader.h"
+#include "../utils/UseFlagDictionary.h"
 #include <KLocalizedString>
 #include <QProcess>
 #include <QDebug>
-#include <QFile>
-#include <QXmlStreamReader>
 #include <QDir>
 #include <QInputDialog>
 #include <algorithm>
@@ -90,7 +91,7 @@ QString PortageResource::availableVersion() const
     }
     
     // For non-installed packages, check if multiple versions available
-    QStringList versions = PortageRepositoryReader::getAvailableVersions(m_atom, m_repository);
+    const QStringList &versions = cachedVersions();
     if (versions.size() > 1) {
         return QStringLiteral("multiple versions");
     } else if (versions.size() == 1) {
@@ -111,19 +112,27 @@ QString PortageResource::installedVersion() const
     return m_installedVersion;
 }
 
+const QStringList &PortageResource::cachedVersions() const
+{
+    // The list view asks for every visible row, only the first call looks the versions up
+    if (!m_versionsLoaded) {
+        m_availableVersions = PortageRepositoryReader::getAvailableVersions(m_atom, m_repository);
+        m_versionsLoaded = true;
+    }
+    return m_availableVersions;
+}
+
 QStringList PortageResource::availableVersions()
 {
     // Lazy-load versions on first access to avoid scanning 20k+ packages at startup
-    if (m_availableVersions.isEmpty()) {
-        m_availableVersions = PortageRepositoryReader::getAvailableVersions(m_atom, m_repository);
-        
-        // Also set the latest as available version if not already set
-        if (!m_availableVersions.isEmpty() && m_availableVersion == QStringLiteral("0.0.0")) {
-            m_availableVersion = m_availableVersions.first();
-        }
+    const QStringList &versions = cachedVersions();
+    
+    // Also set the latest as available version if not already set
+    if (!versions.isEmpty() && m_availableVersion == QStringLiteral("0.0.0")) {
+        m_availableVersion = versions.first();
     }
     
-    return m_availableVersions;
+    return versions;
 }
 
 QString PortageResource::longDescription()
@@ -151,11 +160,32 @@ bool PortageResource::hasCategory(const QString &category) const
 
 QUrl PortageResource::homepage()
 {
-    return QUrl(QStringLiteral("https://github.com/keklick1337/discover-portage-backend/") + m_atom);
+    if (m_longDescription.isEmpty()) {
+        loadMetadata();
+    }
+    
+    if (!m_homepage.isEmpty()) {
+        return QUrl(m_homepage);
+    }
+    return QUrl(QStringLiteral("https://packages.gentoo.org/packages/") + m_atom);
 }
 
 QUrl PortageResource::bugURL()
 {
+    if (m_longDescription.isEmpty()) {
+        loadMetadata();
+    }
+    
+    // Upstream's tracker if metadata.xml names one, it may also be a plain address
+    if (!m_bugsTo.isEmpty()) {
+        const QUrl url(m_bugsTo);
+        if (!url.scheme().isEmpty()) {
+            return url;
+        }
+        if (m_bugsTo.contains(QLatin1Char('@'))) {
+            return QUrl(QStringLiteral("mailto:") + m_bugsTo);
+        }
+    }
     return QUrl(QStringLiteral("https://github.com/keklick1337/discover-portage-backend/issues"));
 }
 
@@ -166,22 +196,33 @@ QUrl PortageResource::url() const
 
 QJsonArray PortageResource::licenses()
 {
+    if (m_longDescription.isEmpty()) {
+        loadMetadata();
+    }
+    
+    // LICENSE is a dependency-style expression, list the license names only
     QJsonArray array;
-    array.append(QStringLiteral("GPL-2"));
+    const QStringList tokens = m_license.split(QLatin1Char(' '), Qt::SkipEmptyParts);
+    for (const QString &token : tokens) {
+        if (token == QLatin1String("||") || token == QLatin1String("(") || token == QLatin1String(")")
+            || token.endsWith(QLatin1Char('?'))) {
+            continue;
+        }
+        if (!array.contains(token)) {
+            array.append(token);
+        }
+    }
     return array;
 }
 
 QString PortageResource::author() const
 {
-    // Use the first maintainer if available. The metadata parser
-    // collects multiple maintainer names/emails into lists.
+    // Use the first maintainer if available
     QString name;
     QString email;
-    if (!m_maintainerNames.isEmpty()) {
-        name = m_maintainerNames.first();
-    }
-    if (!m_maintainerEmails.isEmpty()) {
-        email = m_maintainerEmails.first();
+    if (!m_maintainers.isEmpty()) {
+        name = m_maintainers.first().name;
+        email = m_maintainers.first().email;
     }
 
     if (!name.isEmpty()) {
@@ -205,6 +246,12 @@ void PortageResource::invokeApplication() const
 
 void PortageResource::fetchChangelog()
 {
+    // No ChangeLog files in the tree; for an upgrade show what its USE would change
+    const QStringList useChanges = upgradeUseChanges();
+    if (m_state == AbstractResource::Upgradeable && !useChanges.isEmpty()) {
+        Q_EMIT changelogFetched(i18n("USE changes in %1: %2", m_availableVersion, useChanges.join(QLatin1Char(' '))));
+        return;
+    }
     qDebug() << "Portage: fetchChangelog() stub";
     Q_EMIT changelogFetched(QStringLiteral("Changelog not yet implemented."));
 }
@@ -250,91 +297,63 @@ void PortageResource::loadMetadata()
         return;
     }
 
-    parseMetadataXml(pkgDirPath);
-    parseEbuildDescription(pkgDirPath);
+    // Shared with the USE flags dialog, usually prefetched while the search results came in
+    const MetadataXmlRecord record = PortageMetadataXml::instance().record(pkgDirPath);
+    m_maintainers = record.maintainers;
+    m_xmlLongDescription = record.longDescription;
+    m_bugsTo = record.bugsTo;
+    m_useFlagDescriptions.insert(record.flagDescriptions);
+    
+    loadEbuildMetadata();
     m_longDescription = formatLongDescription();
 }
 
-void PortageResource::parseMetadataXml(const QString &pkgDirPath)
+void PortageResource::releaseMetadata()
 {
-    QFile file(pkgDirPath + QStringLiteral("/metadata.xml"));
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        return;
-    }
-    
-    QXmlStreamReader xml(&file);
-    while (!xml.atEnd()) {
-        xml.readNext();
-        if (xml.isStartElement()) {
-            if (xml.name() == QLatin1String("maintainer")) {
-                // inside maintainer block - collect one maintainer
-                QString mEmail, mName;
-                while (!(xml.isEndElement() && xml.name() == QLatin1String("maintainer"))) {
-                    xml.readNext();
-                    if (xml.isStartElement()) {
-                        if (xml.name() == QLatin1String("email")) {
-                            mEmail = xml.readElementText(QXmlStreamReader::IncludeChildElements).simplified();
-                        } else if (xml.name() == QLatin1String("name")) {
-                            mName = xml.readElementText(QXmlStreamReader::IncludeChildElements).simplified();
-                        }
-                    }
-                }
-                // Store this maintainer
-                if (!mEmail.isEmpty()) {
-                    m_maintainerEmails.append(mEmail);
-                }
-                if (!mName.isEmpty()) {
-                    m_maintainerNames.append(mName);
-                }
-            } else if (xml.name() == QLatin1String("flag")) {
-                const QString fname = xml.attributes().value(QLatin1String("name")).toString();
-                const QString fdesc = xml.readElementText(QXmlStreamReader::IncludeChildElements).simplified();
-                if (!fname.isEmpty()) {
-                    m_useFlagDescriptions.insert(fname, fdesc);
-                }
-            }
-        }
-    }
-    
-    if (xml.hasError()) {
-        qDebug() << "Portage: XML parse error for" << m_atom << ":" << xml.errorString();
-    }
-    file.close();
+    // Maintainers and USE descriptions stay, author() and useFlagsInformation() don't reload them
+    m_availableVersions.clear();
+    m_versionsLoaded = false;
+    m_longDescription.clear();
+    m_ebuildDescription.clear();
+    m_homepage.clear();
+    m_license.clear();
+    m_xmlLongDescription.clear();
+    m_bugsTo.clear();
 }
 
-void PortageResource::parseEbuildDescription(const QString &pkgDirPath)
+void PortageResource::invalidateRepositoryData()
 {
-    QDir pkgDir(pkgDirPath);
-    if (!pkgDir.exists()) {
+    releaseMetadata();
+    Q_EMIT metadataChanged();
+    Q_EMIT versionChanged();
+}
+
+void PortageResource::loadEbuildMetadata()
+{
+    const QString repoPath = PortageRepositoryConfig::instance().getRepositoryLocation(m_repository);
+    if (repoPath.isEmpty()) {
         return;
     }
     
-    const QStringList ebuilds = pkgDir.entryList(QStringList() << QStringLiteral("*.ebuild"), QDir::Files, QDir::Name);
-    if (ebuilds.isEmpty()) {
-        return;
+    // Describe the version the user is looking at: requested, installed, else the newest one
+    PortageMetadataCache &cache = PortageMetadataCache::instance();
+    EbuildMetadata md = cache.metadata(repoPath, m_atom, m_requestedVersion);
+    if (!md.isValid()) {
+        md = cache.metadata(repoPath, m_atom, m_installedVersion);
     }
-    
-    // pick the lexicographically last ebuild (usually newest)
-    const QString ebuildFile = pkgDir.absoluteFilePath(ebuilds.last());
-    QFile ef(ebuildFile);
-    if (!ef.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    if (!md.isValid()) {
+        const QStringList versions = availableVersions();
+        if (!versions.isEmpty()) {
+            md = cache.metadata(repoPath, m_atom, versions.first());
+        }
+    }
+    if (!md.isValid()) {
         return;
     }
     
-    const QString contents = QString::fromUtf8(ef.readAll());
-    // Match DESCRIPTION="..." or DESCRIPTION='...' - may be multiline
-    // Using non-greedy match and DOTALL-like behavior
-    QRegularExpression re(QStringLiteral(R"(DESCRIPTION\s*=\s*[\"']([^\"']*)[\"'])"));
-    QRegularExpressionMatch match = re.match(contents);
-    if (match.hasMatch()) {
-        QString desc = match.captured(1);
-        // Normalize whitespace: replace newlines/tabs with spaces, collapse multiple spaces
-        desc = desc.simplified();
-        if (!desc.isEmpty()) {
-            m_ebuildDescription = desc;
-        }
-    }
-    ef.close();
+    m_ebuildDescription = md.description.simplified();
+    m_homepage = md.homepage.section(QLatin1Char(' '), 0, 0, QString::SectionSkipEmpty);
+    m_license = md.license;
 }
 
 QString PortageResource::formatLongDescription()
@@ -345,21 +364,21 @@ QString PortageResource::formatLongDescription()
     const QString descriptionText = !m_ebuildDescription.isEmpty() ? m_ebuildDescription : m_summary;
     parts << QStringLiteral("<div>") + descriptionText.toHtmlEscaped() + QStringLiteral("</div>");
 
+    if (!m_xmlLongDescription.isEmpty()) {
+        parts << QStringLiteral("<p>") + m_xmlLongDescription.toHtmlEscaped() + QStringLiteral("</p>");
+    }
+
     if (hasMaintainerInfo()) {
         parts << QStringLiteral("<p><strong>Maintainer(s):</strong></p>");
         parts << QStringLiteral("<ul>");
 
-        int maxCount = qMax(m_maintainerNames.size(), m_maintainerEmails.size());
-        for (int i = 0; i < maxCount; ++i) {
-            QString maintLine;
-            if (i < m_maintainerNames.size()) {
-                maintLine = m_maintainerNames[i].toHtmlEscaped();
-            }
-            if (i < m_maintainerEmails.size()) {
+        for (const MetadataXmlRecord::Maintainer &maintainer : std::as_const(m_maintainers)) {
+            QString maintLine = maintainer.name.toHtmlEscaped();
+            if (!maintainer.email.isEmpty()) {
                 if (!maintLine.isEmpty()) {
-                    maintLine += QStringLiteral(" &lt;") + m_maintainerEmails[i].toHtmlEscaped() + QStringLiteral("&gt;");
+                    maintLine += QStringLiteral(" &lt;") + maintainer.email.toHtmlEscaped() + QStringLiteral("&gt;");
                 } else {
-                    maintLine = QStringLiteral("&lt;") + m_maintainerEmails[i].toHtmlEscaped() + QStringLiteral("&gt;");
+                    maintLine = QStringLiteral("&lt;") + maintainer.email.toHtmlEscaped() + QStringLiteral("&gt;");
                 }
             }
             if (!maintLine.isEmpty()) {
@@ -385,29 +404,106 @@ QString PortageResource::formatLongDescription()
 
 bool PortageResource::hasMaintainerInfo() const
 {
-    return !m_maintainerNames.isEmpty() || !m_maintainerEmails.isEmpty();
+    return !m_maintainers.isEmpty();
+}
+
+void PortageResource::assignIuse(const QStringList &iuse)
+{
+    UseFlagDictionary &dict = UseFlagDictionary::instance();
+    
+    m_iuseOrder.clear();
+    m_iuse.clear();
+    m_defaultUse.clear();
+    m_iuseOrder.reserve(iuse.size());
+    
+    for (const QString &entry : iuse) {
+        // Raw IUSE carries +/- default markers, parsed lists don't
+        const bool isDefault = entry.startsWith(QLatin1Char('+'));
+        const QString flag = (isDefault || entry.startsWith(QLatin1Char('-'))) ? entry.mid(1) : entry;
+        if (flag.isEmpty()) {
+            continue;
+        }
+        
+        const int id = dict.intern(flag);
+        if (m_iuse.contains(id)) {
+            continue;
+        }
+        m_iuse.insert(id);
+        m_iuseOrder << id;
+        if (isDefault) {
+            m_defaultUse.insert(id);
+        }
+    }
+}
+
+void PortageResource::assignConfiguredUse(const QStringList &flags)
+{
+    UseFlagDictionary &dict = UseFlagDictionary::instance();
+    
+    m_configuredOn.clear();
+    m_configuredOff.clear();
+    
+    // Later entries win, as in package.use
+    for (const QString &entry : flags) {
+        if (entry.startsWith(QLatin1Char('-'))) {
+            const int id = dict.intern(entry.mid(1));
+            m_configuredOn.remove(id);
+            m_configuredOff.insert(id);
+        } else {
+            const int id = dict.intern(entry.startsWith(QLatin1Char('+')) ? entry.mid(1) : entry);
+            m_configuredOff.remove(id);
+            m_configuredOn.insert(id);
+        }
+    }
+}
+
+QStringList PortageResource::availableUseFlags() const
+{
+    const UseFlagDictionary &dict = UseFlagDictionary::instance();
+    
+    QStringList flags;
+    flags.reserve(m_iuseOrder.size());
+    for (int id : m_iuseOrder) {
+        flags << dict.name(id);
+    }
+    return flags;
+}
+
+QStringList PortageResource::configuredUseFlags() const
+{
+    QStringList flags = m_configuredOn.toStringList();
+    const QStringList disabled = m_configuredOff.toStringList();
+    for (const QString &flag : disabled) {
+        flags << QLatin1Char('-') + flag;
+    }
+    return flags;
 }
 
 void PortageResource::setConfiguredUseFlags(const QStringList &flags)
 {
-    if (m_configuredUseFlags != flags) {
-        m_configuredUseFlags = flags;
+    const UseFlagSet previousOn = m_configuredOn;
+    const UseFlagSet previousOff = m_configuredOff;
+    assignConfiguredUse(flags);
+    if (m_configuredOn != previousOn || m_configuredOff != previousOff) {
         Q_EMIT useFlagsChanged();
     }
 }
 
 void PortageResource::setInstalledUseFlags(const QStringList &flags)
 {
-    if (m_installedUseFlags != flags) {
-        m_installedUseFlags = flags;
+    const UseFlagSet enabled = UseFlagSet::fromFlags(flags);
+    if (m_enabledUse != enabled) {
+        m_enabledUse = enabled;
         Q_EMIT useFlagsChanged();
     }
 }
 
 void PortageResource::setAvailableUseFlags(const QStringList &flags)
 {
-    if (m_availableUseFlags != flags) {
-        m_availableUseFlags = flags;
+    const QList<int> previousOrder = m_iuseOrder;
+    const UseFlagSet previousDefaults = m_defaultUse;
+    assignIuse(flags);
+    if (m_iuseOrder != previousOrder || m_defaultUse != previousDefaults) {
         Q_EMIT useFlagsChanged();
     }
 }
@@ -416,6 +512,12 @@ void PortageResource::setRepository(const QString &repo)
 {
     if (m_repository != repo) {
         m_repository = repo;
+        
+        // Versions and ebuild metadata came from the previous repository
+        m_availableVersions.clear();
+        m_versionsLoaded = false;
+        m_availableVersion = QStringLiteral("0.0.0");
+        m_longDescription.clear();
         Q_EMIT metadataChanged();
     }
 }
@@ -428,12 +530,94 @@ void PortageResource::setSlot(const QString &slot)
     }
 }
 
+void PortageResource::setInstalledInfo(const InstalledPackageInfo &info)
+{
+    m_installedVersion = info.version;
+    // Built from another repository than the one it was materialized from: its versions and metadata apply
+    setRepository(info.repository);
+    m_slot = info.slot;
+    m_enabledUse = UseFlagSet::fromFlags(info.useFlags);
+    assignIuse(info.availableUseFlags);
+    m_size = quint64(info.size);
+    
+    // vdb keeps DESCRIPTION, so installed packages get a summary without touching the repository
+    if (m_summary.isEmpty()) {
+        m_summary = info.description;
+    }
+    
+    setState(AbstractResource::Installed);
+    Q_EMIT metadataChanged();
+    Q_EMIT useFlagsChanged();
+}
+
+void PortageResource::clearInstalledInfo()
+{
+    m_installedVersion.clear();
+    m_enabledUse.clear();
+    m_upgradeOn.clear();
+    m_upgradeOff.clear();
+    m_size = 0;
+    
+    setState(AbstractResource::None);
+    Q_EMIT metadataChanged();
+    Q_EMIT useFlagsChanged();
+}
+
+void PortageResource::setUpgradeVersion(const QString &version)
+{
+    if (m_state != AbstractResource::Installed && m_state != AbstractResource::Upgradeable) {
+        return;
+    }
+    
+    if (version.isEmpty() || m_availableVersion != version) {
+        // The prediction belonged to the previous upgrade version
+        m_upgradeOn.clear();
+        m_upgradeOff.clear();
+    }
+    
+    if (version.isEmpty()) {
+        setState(AbstractResource::Installed);
+        return;
+    }
+    
+    if (m_availableVersion != version) {
+        m_availableVersion = version;
+        Q_EMIT versionChanged();
+    }
+    setState(AbstractResource::Upgradeable);
+}
+
+void PortageResource::setUpgradeUse(const UseFlagSet &enabled, const UseFlagSet &disabled)
+{
+    if (m_upgradeOn == enabled && m_upgradeOff == disabled) {
+        return;
+    }
+    m_upgradeOn = enabled;
+    m_upgradeOff = disabled;
+    Q_EMIT useFlagsChanged();
+}
+
+QStringList PortageResource::upgradeUseChanges() const
+{
+    UseFlagSet added = m_upgradeOn;
+    added.subtract(m_enabledUse);
+    
+    QStringList changes;
+    for (const QString &flag : added.toStringList()) {
+        changes << QLatin1Char('+') + flag;
+    }
+    for (const QString &flag : (m_upgradeOff & m_enabledUse).toStringList()) {
+        changes << QLatin1Char('-') + flag;
+    }
+    return changes;
+}
+
 bool PortageResource::saveUseFlags(const QStringList &flags)
 {
     qDebug() << "PortageResource::saveUseFlags() - saving flags for" << m_atom << ":" << flags;
     
     MakeConfReader makeConf;
-    QStringList globalL10n = makeConf.readL10N();
+    const QHash<QString, QStringList> useExpand = makeConf.readUseExpand();
     QStringList globalUse = makeConf.readGlobalUseFlags();
     QStringList packageUseGlobal = makeConf.readGlobalPackageUse();
     
@@ -442,8 +626,10 @@ bool PortageResource::saveUseFlags(const QStringList &flags)
         if (flag.startsWith(QLatin1Char('-'))) {
             filteredFlags << flag;
         }
-        else if (flag.startsWith(QStringLiteral("l10n_")) && globalL10n.contains(flag)) {
-            qDebug() << "PortageResource: Skipping L10N flag" << flag << "(already in make.conf)";
+        else if (std::any_of(useExpand.constBegin(), useExpand.constEnd(), [&flag](const QStringList &expanded) {
+                     return expanded.contains(flag);
+                 })) {
+            qDebug() << "PortageResource: Skipping USE_EXPAND flag" << flag << "(already in make.conf)";
             continue;
         }
         else if (globalUse.contains(flag) || packageUseGlobal.contains(flag)) {
@@ -460,7 +646,7 @@ bool PortageResource::saveUseFlags(const QStringList &flags)
     // If all flags were filtered out (all are already global), no need to write to package.use
     if (filteredFlags.isEmpty()) {
         qDebug() << "PortageResource: All USE flags are already global, skipping package.use write";
-        m_configuredUseFlags.clear();
+        setConfiguredUseFlags({});
         return true;
     }
     
@@ -469,7 +655,7 @@ bool PortageResource::saveUseFlags(const QStringList &flags)
     authClient->setUseFlags(m_atom, filteredFlags, [this, authClient, filteredFlags](bool ok, const QString &/*output*/, const QString &error) {
         if (ok) {
             qDebug() << "PortageResource: Successfully saved USE flags for" << m_atom;
-            m_configuredUseFlags = filteredFlags;
+            setConfiguredUseFlags(filteredFlags);
         } else {
             qWarning() << "PortageResource: Failed to save USE flags:" << error;
         }
@@ -497,11 +683,11 @@ void PortageResource::loadUseFlagInfo()
         }
         
         if (!info.activeFlags.isEmpty()) {
-            m_installedUseFlags = info.activeFlags;
+            m_enabledUse = UseFlagSet::fromFlags(info.activeFlags);
         }
         
         if (!info.availableFlags.isEmpty()) {
-            m_availableUseFlags = info.availableFlags;
+            assignIuse(info.rawIuse.isEmpty() ? info.availableFlags : info.rawIuse);
         }
         
         if (!info.descriptions.isEmpty()) {
@@ -517,8 +703,8 @@ void PortageResource::loadUseFlagInfo()
         }
     } else if (m_state == AbstractResource::None) {
         // Package was removed - clear USE flags
-        m_installedUseFlags.clear();
-        m_availableUseFlags.clear();
+        m_enabledUse.clear();
+        assignIuse({});
         m_useFlagDescriptions.clear();
         //qDebug() << "Cleared USE flags for removed package" << m_atom;
     } else {
@@ -544,7 +730,7 @@ void PortageResource::loadUseFlagInfo()
         UseFlagInfo info = useFlagManager.readRepositoryPackageInfo(m_atom, version, repoPath);
         
         if (!info.availableFlags.isEmpty()) {
-            m_availableUseFlags = info.availableFlags;
+            assignIuse(info.rawIuse.isEmpty() ? info.availableFlags : info.rawIuse);
         }
         
         if (!info.descriptions.isEmpty()) {
@@ -560,13 +746,13 @@ void PortageResource::loadUseFlagInfo()
         for (auto it = configured.constBegin(); it != configured.constEnd(); ++it) {
             allConfigured << it.value();
         }
-        m_configuredUseFlags = allConfigured;
+        assignConfiguredUse(allConfigured);
     }
     
     //qDebug() << "Loaded USE flag info for" << m_atom 
-    //         << "- Installed:" << m_installedUseFlags.size()
-    //         << "Available:" << m_availableUseFlags.size()
-    //         << "Configured:" << m_configuredUseFlags.size();
+    //         << "- Installed:" << m_enabledUse.count()
+    //         << "Available:" << m_iuseOrder.size()
+    //         << "Configured:" << m_configuredOn.count() + m_configuredOff.count();
     
     // Emit signal to update UI
     Q_EMIT useFlagsChanged();
@@ -589,45 +775,32 @@ QVariantList PortageResource::useFlagsInformation()
 {
     qDebug() << "PortageResource::useFlagsInformation() called for" << m_atom
              << "state:" << m_state
-             << "available:" << m_availableUseFlags.size()
-             << "installed:" << m_installedUseFlags.size();
+             << "available:" << m_iuseOrder.size()
+             << "installed:" << m_enabledUse.count();
     
-    QVariantList useFlags;
-    
-    // If package is not installed, show available USE flags from IUSE
-    if (m_state != AbstractResource::Installed && m_state != AbstractResource::Upgradeable) {
-        for (const QString &flag : m_availableUseFlags) {
-            // Check if flag is in configured flags
-            bool enabled = m_configuredUseFlags.contains(flag) || m_configuredUseFlags.contains(QLatin1Char('+') + flag);
-            bool disabled = m_configuredUseFlags.contains(QLatin1Char('-') + flag);
-            
-            if (disabled) {
-                enabled = false;
-            }
-            
-            QString description = m_useFlagDescriptions.value(flag, flag);
-            
-            QVariantMap flagData;
-            flagData[QStringLiteral("name")] = flag;
-            flagData[QStringLiteral("packageName")] = flag;
-            flagData[QStringLiteral("description")] = description;
-            flagData[QStringLiteral("installed")] = enabled;
-            
-            useFlags << flagData;
-        }
-        return useFlags;
+    // Installed packages show what they were built with. Otherwise
+    // show what a build would use: IUSE defaults overridden by package.use
+    UseFlagSet enabled;
+    if (m_state == AbstractResource::Installed || m_state == AbstractResource::Upgradeable) {
+        enabled = m_enabledUse;
+    } else {
+        enabled = m_defaultUse;
+        enabled.subtract(m_configuredOff);
+        enabled |= m_configuredOn;
     }
     
-    // For installed packages, show all available flags with current state
-    for (const QString &flag : m_availableUseFlags) {
-        bool isInstalled = m_installedUseFlags.contains(flag);
-        QString description = m_useFlagDescriptions.value(flag, flag);
+    const UseFlagDictionary &dict = UseFlagDictionary::instance();
+    
+    QVariantList useFlags;
+    useFlags.reserve(m_iuseOrder.size());
+    for (int id : m_iuseOrder) {
+        const QString flag = dict.name(id);
         
         QVariantMap flagData;
         flagData[QStringLiteral("name")] = flag;
         flagData[QStringLiteral("packageName")] = flag;
-        flagData[QStringLiteral("description")] = description;
-        flagData[QStringLiteral("installed")] = isInstalled;
+        flagData[QStringLiteral("description")] = m_useFlagDescriptions.value(flag, flag);
+        flagData[QStringLiteral("installed")] = enabled.contains(id);
         
         useFlags << flagData;
     }
@@ -8,6 +8,11 @@
 #include <resources/AbstractResource.h>
 #include <QStringList>
 
+#include "../repository/PortageMetadataXml.h"
+#include "../utils/UseFlagSet.h"
+
+struct InstalledPackageInfo;
+
 class PortageResource : public AbstractResource
 {
     Q_OBJECT
@@ -15,6 +20,7 @@ class PortageResource : public AbstractResource
     Q_PROPERTY(QStringList availableUseFlags READ availableUseFlags NOTIFY useFlagsChanged)
     Q_PROPERTY(QStringList configuredUseFlags READ configuredUseFlags WRITE setConfiguredUseFlags NOTIFY useFlagsChanged)
     Q_PROPERTY(QVariantList useFlagsInformation READ useFlagsInformation NOTIFY useFlagsChanged)
+    Q_PROPERTY(QStringList upgradeUseChanges READ upgradeUseChanges NOTIFY useFlagsChanged)
     Q_PROPERTY(QStringList availableVersions READ availableVersions NOTIFY metadataChanged)
     Q_PROPERTY(QString requestedVersion READ requestedVersion WRITE setRequestedVersion NOTIFY metadataChanged)
     Q_PROPERTY(QString slot READ slot NOTIFY metadataChanged)
@@ -76,9 +82,25 @@ public:
     void setSize(quint64 size) { m_size = size; }
     void setRepository(const QString &repo);
     void setSlot(const QString &slot);
+    
+    // Apply state read from /var/db/pkg in one go, without re-reading it
+    void setInstalledInfo(const InstalledPackageInfo &info);
+    void clearInstalledInfo();
+    
+    // Result of the update check: the newer version to offer, or empty if up to date
+    void setUpgradeVersion(const QString &version);
+    
+    // Predicted USE of the upgrade version; upgradeUseChanges() lists "+flag"/"-flag" against the installed build
+    void setUpgradeUse(const UseFlagSet &enabled, const UseFlagSet &disabled);
+    QStringList upgradeUseChanges() const;
 
     QStringList availableVersions();
-    void setAvailableVersions(const QStringList &versions) { m_availableVersions = versions; Q_EMIT metadataChanged(); }
+    void setAvailableVersions(const QStringList &versions)
+    {
+        m_availableVersions = versions;
+        m_versionsLoaded = true;
+        Q_EMIT metadataChanged();
+    }
 
     QString requestedVersion() const { return m_requestedVersion; }
     void setRequestedVersion(const QString &v) { m_requestedVersion = v; Q_EMIT metadataChanged(); }
@@ -87,13 +109,13 @@ public:
     Q_INVOKABLE void requestReinstall();
     
     // USE flag management
-    QStringList installedUseFlags() const { return m_installedUseFlags; }
+    QStringList installedUseFlags() const { return m_enabledUse.toStringList(); }
     void setInstalledUseFlags(const QStringList &flags);
     
-    QStringList availableUseFlags() const { return m_availableUseFlags; }
+    QStringList availableUseFlags() const;
     void setAvailableUseFlags(const QStringList &flags);
     
-    QStringList configuredUseFlags() const { return m_configuredUseFlags; }
+    QStringList configuredUseFlags() const;
     void setConfiguredUseFlags(const QStringList &flags);
     
     Q_INVOKABLE bool saveUseFlags(const QStringList &flags);
@@ -111,11 +133,19 @@ public:
     void loadMetadata();
     void loadUseFlagInfo();
 
+    // Drop ebuild/metadata.xml details and the version list, every getter reloads them on demand
+    void releaseMetadata();
+
+    // The repository was synced: like releaseMetadata(), and views are told to read again
+    void invalidateRepositoryData();
+
 private:
-    void parseMetadataXml(const QString &pkgDirPath);
-    void parseEbuildDescription(const QString &pkgDirPath);
+    void loadEbuildMetadata();
     QString formatLongDescription();
     bool hasMaintainerInfo() const;
+    void assignIuse(const QStringList &iuse);
+    void assignConfiguredUse(const QStringList &flags);
+    const QStringList &cachedVersions() const;
 
 Q_SIGNALS:
     void useFlagsChanged();
@@ -136,18 +166,28 @@ private:
     AbstractResource::State m_state;
     QSet<QString> m_discoverCategories;
     
-    QStringList m_installedUseFlags;    // Currently active USE flags (from /var/db/pkg)
-    QStringList m_availableUseFlags;    // All available USE flags (from IUSE)
-    QStringList m_configuredUseFlags;   // User-configured USE flags (from /etc/portage/package.use)
+    // USE flags as UseFlagDictionary ids
+    QList<int> m_iuseOrder;             // IUSE in ebuild order, for display
+    UseFlagSet m_iuse;                  // All available USE flags (from IUSE)
+    UseFlagSet m_defaultUse;            // IUSE flags enabled by default (+flag)
+    UseFlagSet m_enabledUse;            // Currently active USE flags (from /var/db/pkg)
+    UseFlagSet m_configuredOn;          // User-configured USE flags (from /etc/portage/package.use)
+    UseFlagSet m_configuredOff;         // ... and the ones disabled there (-flag)
+    UseFlagSet m_upgradeOn;             // Predicted for the upgrade version, see setUpgradeUse()
+    UseFlagSet m_upgradeOff;
     
     QString m_keyword;
 
-    QStringList m_availableVersions;
+    mutable QStringList m_availableVersions; // newest first, filled on first use
+    mutable bool m_versionsLoaded = false;
     QString m_requestedVersion;
 
     QString m_longDescription;
     QString m_ebuildDescription;
-    QStringList m_maintainerNames;
-    QStringList m_maintainerEmails;
+    QString m_homepage;
+    QString m_license;
+    QString m_xmlLongDescription; // metadata.xml <longdescription>
+    QString m_bugsTo;             // metadata.xml <upstream><bugs-to>
+    QList<MetadataXmlRecord::Maintainer> m_maintainers;
     QMap<QString, QString> m_useFlagDescriptions; // flag name -> description
 };
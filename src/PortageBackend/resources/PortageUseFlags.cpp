@@ -4,12 +4,19 @@
  */
 
 #include "PortageUseFlags.h"
-#include "config/MakeConfReader.h"
+#include "../cache/UseFlagInfoCache.h"
+#include "../config/PortageConfigIndex.h"
+#include "../config/PortageProfileStack.h"
 #include "../repository/PortageRepositoryReader.h"
 #include "../repository/PortageRepositoryConfig.h"
+#include "../repository/PortageMetadataCache.h"
+#include "../repository/PortageMetadataXml.h"
 #include "../installed/PortageInstalledReader.h"
 #include "../utils/StringUtils.h"
 #include "../utils/PortagePaths.h"
+#include "../utils/PortageVersion.h"
+#include "../utils/UseFlagDictionary.h"
+#include "../utils/UseFlagSet.h"
 #include <QFile>
 #include <QDir>
 #include <QTextStream>
@@ -17,7 +24,38 @@
 #include <QRegularExpression>
 #include <QDateTime>
 #include <QFileInfo>
-#include <QProcess>
+#include <QtConcurrent>
+
+namespace
+{
+// One package.use line: "flag -flag", "-*" resets, "VIDEO_CARDS: -* intel" works on the
+// video_cards_ flags only until the next "VAR:" group
+void applyPackageUseTokens(UseFlagSet &flags, const QStringList &tokens)
+{
+    UseFlagDictionary &dict = UseFlagDictionary::instance();
+    QString prefix;
+    for (const QString &token : tokens) {
+        if (token.endsWith(QLatin1Char(':'))) {
+            prefix = token.chopped(1).toLower() + QLatin1Char('_');
+        } else if (token == QLatin1String("-*")) {
+            if (prefix.isEmpty()) {
+                flags.clear();
+                continue;
+            }
+            const QList<int> ids = flags.ids();
+            for (int id : ids) {
+                if (dict.name(id).startsWith(prefix)) {
+                    flags.remove(id);
+                }
+            }
+        } else if (token.startsWith(QLatin1Char('-'))) {
+            flags.remove(dict.find(prefix + token.mid(1)));
+        } else {
+            flags.insert(dict.intern(prefix + token));
+        }
+    }
+}
+}
 
 PortageUseFlags::PortageUseFlags(QObject *parent)
     : QObject(parent)
@@ -40,9 +78,10 @@ UseFlagInfo PortageUseFlags::readInstalledPackageInfo(const QString &atom, const
         }
     }
     
-    const QString cacheKey = atom + QStringLiteral("-") + actualVersion;
-    if (m_cache.contains(cacheKey)) {
-        return m_cache.value(cacheKey);
+    UseFlagInfoCache &cache = UseFlagInfoCache::instance();
+    quint64 epoch = 0;
+    if (const std::optional<UseFlagInfo> cached = cache.find(atom, actualVersion, QString(), epoch)) {
+        return *cached;
     }
 
     UseFlagInfo info;
@@ -54,6 +93,7 @@ UseFlagInfo PortageUseFlags::readInstalledPackageInfo(const QString &atom, const
 
     const QString iuseContent = readVarDbFile(atom, actualVersion, QStringLiteral("IUSE"));
     info.availableFlags = parseIUSE(iuseContent);
+    info.rawIuse = iuseContent.simplified().split(QLatin1Char(' '), Qt::SkipEmptyParts);
 
     info.repository = readVarDbFile(atom, actualVersion, QStringLiteral("repository")).trimmed();
 
@@ -63,12 +103,11 @@ UseFlagInfo PortageUseFlags::readInstalledPackageInfo(const QString &atom, const
     if (!info.repository.isEmpty()) {
         QString pkgPath = PortageRepositoryReader::findPackagePath(atom, info.repository);
         if (!pkgPath.isEmpty()) {
-            QString metadataPath = pkgPath + QStringLiteral("/metadata.xml");
-            info.descriptions = parseMetadataXml(metadataPath);
+            info.descriptions = PortageMetadataXml::instance().record(pkgPath).flagDescriptions;
         }
     }
 
-    m_cache.insert(cacheKey, info);
+    cache.insert(atom, actualVersion, QString(), info, epoch);
 
     qDebug() << "PortageUseFlags: Read installed package info for" << atom << actualVersion
              << "- Active:" << info.activeFlags.size() << "Available:" << info.availableFlags.size()
@@ -193,32 +232,13 @@ QMap<QString, QStringList> PortageUseFlags::readPackageUseConfig(const QString &
 {
     QMap<QString, QStringList> result;
     
-    const QStringList files = findPackageUseFiles(atom);
-    
-    for (const QString &filePath : files) {
-        QFile file(filePath);
-        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            continue;
-        }
-
-        QTextStream in(&file);
-        while (!in.atEnd()) {
-            QString line = in.readLine().trimmed();
-            
-            if (line.isEmpty() || line.startsWith(QLatin1Char('#'))) {
-                continue;
-            }
-
-            // Line format: "category/package flag1 flag2 -flag3"
-            if (line.contains(atom)) {
-                QStringList parts = line.split(QRegularExpression(QStringLiteral("\\s+")), Qt::SkipEmptyParts);
-                if (!parts.isEmpty() && parts.first() == atom) {
-                    parts.removeFirst();
-                    result.insert(filePath, parts);
-                }
-            }
+    // Line format: "category/package flag1 flag2 -flag3", only plain atom lines count here
+    const QList<PortageConfigIndex::Entry> entries =
+        PortageConfigIndex::instance().entriesFor(PortageConfigIndex::PackageUse, atom);
+    for (const PortageConfigIndex::Entry &entry : entries) {
+        if (entry.atom == atom) {
+            result.insert(entry.file, entry.values);
         }
-        file.close();
     }
 
     return result;
@@ -227,31 +247,13 @@ QMap<QString, QStringList> PortageUseFlags::readPackageUseConfig(const QString &
 QStringList PortageUseFlags::findPackageUseFiles(const QString &atom)
 {
     QStringList result;
-    const QString packageUseDirectory = packageUseDir();
-    
-    QDir dir(packageUseDirectory);
-    if (!dir.exists()) {
-        qDebug() << "PortageUseFlags: package.use directory not found:" << packageUseDirectory;
-        return result;
-    }
-
-    const QFileInfoList files = dir.entryInfoList(QDir::Files | QDir::NoDotAndDotDot);
     
-    for (const QFileInfo &fileInfo : files) {
-        QFile file(fileInfo.absoluteFilePath());
-        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            continue;
+    const QList<PortageConfigIndex::Entry> entries =
+        PortageConfigIndex::instance().entriesFor(PortageConfigIndex::PackageUse, atom);
+    for (const PortageConfigIndex::Entry &entry : entries) {
+        if (!entry.spec.hasWildcard() && !result.contains(entry.file)) {
+            result << entry.file;
         }
-
-        QTextStream in(&file);
-        while (!in.atEnd()) {
-            QString line = in.readLine().trimmed();
-            if (line.contains(atom)) {
-                result << fileInfo.absoluteFilePath();
-                break;
-            }
-        }
-        file.close();
     }
 
     return result;
@@ -292,6 +294,7 @@ bool PortageUseFlags::writeUseFlags(const QString &atom, const QString &packageN
     out << "\n";
 
     file.close();
+    PortageConfigIndex::instance().invalidate();
 
     qDebug() << "PortageUseFlags: Wrote USE flags for" << atom << "to" << filePath;
     return true;
@@ -347,6 +350,7 @@ bool PortageUseFlags::removeLinesFromFile(const QString &filePath, const QString
         out << line << "\n";
     }
     file.close();
+    PortageConfigIndex::instance().invalidate();
 
     return true;
 }
@@ -361,128 +365,80 @@ QString PortageUseFlags::useFlagFileName(const QString &packageName)
     return QStringLiteral("discover_") + packageName;
 }
 
-QMap<QString, QString> PortageUseFlags::parseMetadataXml(const QString &metadataPath)
+UseFlagInfo PortageUseFlags::readRepositoryPackageInfo(const QString &atom, const QString &version, const QString &repoPath)
 {
-    QMap<QString, QString> descriptions;
-    
-    QFile file(metadataPath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        return descriptions;
+    UseFlagInfoCache &infoCache = UseFlagInfoCache::instance();
+    quint64 epoch = 0;
+    if (const std::optional<UseFlagInfo> cached = infoCache.find(atom, version, repoPath, epoch)) {
+        return *cached;
     }
     
-    QString content = QString::fromUtf8(file.readAll());
-    file.close();
-
-    QRegularExpression flagRegex(QStringLiteral(R"(<flag\s+name=\"([^\"]+)\">([^<]+)</flag>)"));
-    QRegularExpressionMatchIterator it = flagRegex.globalMatch(content);
-    
-    while (it.hasNext()) {
-        QRegularExpressionMatch match = it.next();
-        QString flagName = match.captured(1);
-        QString description = match.captured(2).trimmed();
-
-        description = description.replace(QRegularExpression(QStringLiteral("\\s+")), QStringLiteral(" "));
-
-        descriptions[flagName] = description;
-    }
-    
-    qDebug() << "PortageUseFlags: Parsed" << descriptions.size() << "USE flag descriptions from" << metadataPath;
-    
-    return descriptions;
-}
-
-UseFlagInfo PortageUseFlags::readRepositoryPackageInfo(const QString &atom, const QString &version, const QString &repoPath)
-{
     UseFlagInfo info;
     info.atom = atom;
     info.version = version;
     info.repository = QFileInfo(repoPath).fileName(); // Extract repo name from path
     
-    // Use portageq to get IUSE after ebuild processing (handles dynamic generation like L10N)
-    QProcess portageq;
-    portageq.setProgram(QStringLiteral("portageq"));
-    portageq.setArguments({
-        QStringLiteral("metadata"),
-        QStringLiteral("/"),
-        QStringLiteral("ebuild"),
-        QStringLiteral("%1-%2").arg(atom, version),
-        QStringLiteral("IUSE")
-    });
-    
-    portageq.start();
-    portageq.waitForFinished(10000); // 10 second timeout
-    
-    if (portageq.exitCode() == 0) {
-        QString iuseOutput = QString::fromUtf8(portageq.readAllStandardOutput()).trimmed();
-        
+    // md5-cache holds IUSE after eclass processing (handles dynamic generation like L10N)
+    PortageMetadataCache &cache = PortageMetadataCache::instance();
+    EbuildMetadata md = cache.metadata(repoPath, atom, version);
+    if (!md.isValid()) {
+        // Requested version is not in this repository, describe the newest one it has
+        const QList<EbuildMetadata> all = cache.packageMetadata(repoPath, atom);
+        for (const EbuildMetadata &candidate : all) {
+            if (!md.isValid() || PortageVersion::compare(candidate.version, md.version) > 0) {
+                md = candidate;
+            }
+        }
+    }
+    
+    if (md.isValid()) {
         // Save raw IUSE with prefixes for defaults
-        info.rawIuse = iuseOutput.split(QRegularExpression(QStringLiteral("\\s+")), Qt::SkipEmptyParts);
+        info.rawIuse = md.iuse.split(QLatin1Char(' '), Qt::SkipEmptyParts);
         
         // Parse to get clean flag names (without +/-)
-        info.availableFlags = parseIUSE(iuseOutput);
+        info.availableFlags = parseIUSE(md.iuse);
+        info.slot = md.slot;
         
-        qDebug() << "PortageUseFlags: Got" << info.availableFlags.size() << "flags from portageq for" << atom << version;
+        qDebug() << "PortageUseFlags: Got" << info.availableFlags.size() << "flags from metadata for" << atom << md.version;
     } else {
-        // Fallback to reading ebuild file directly (won't catch dynamic flags like L10N)
-        qDebug() << "PortageUseFlags: portageq failed, falling back to ebuild parsing";
-        
-        QString packageName = extractPackageName(atom);
-        QString ebuildPath = QStringLiteral("%1/%2/%3-%4.ebuild").arg(repoPath, atom, packageName, version);
-        
-        QFile ebuildFile(ebuildPath);
-        if (ebuildFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            QTextStream in(&ebuildFile);
-            QString line;
-            QString iuseAccumulated;
-            
-            // Read ebuild line by line to find all IUSE lines (IUSE= and IUSE+=)
-            while (in.readLineInto(&line)) {
-                QString trimmed = line.trimmed();
-                
-                // Match IUSE= or IUSE+=
-                if (trimmed.startsWith(QStringLiteral("IUSE=")) || trimmed.startsWith(QStringLiteral("IUSE+="))) {
-                    // Extract IUSE value
-                    int eqPos = trimmed.indexOf(QLatin1Char('='));
-                    QString iuseLine = trimmed.mid(eqPos + 1).trimmed();
-                    
-                    // Remove quotes if present
-                    if (iuseLine.startsWith(QLatin1Char('"')) && iuseLine.endsWith(QLatin1Char('"'))) {
-                        iuseLine = iuseLine.mid(1, iuseLine.length() - 2);
-                    }
-                    
-                    // Accumulate all IUSE values
-                    if (!iuseAccumulated.isEmpty()) {
-                        iuseAccumulated += QLatin1Char(' ');
-                    }
-                    iuseAccumulated += iuseLine;
-                }
-            }
-            
-            // Parse accumulated IUSE
-            if (!iuseAccumulated.isEmpty()) {
-                info.availableFlags = parseIUSE(iuseAccumulated);
-            }
-            
-            ebuildFile.close();
-        } else {
-            qDebug() << "PortageUseFlags: Could not open ebuild" << ebuildPath;
-        }
+        qDebug() << "PortageUseFlags: No ebuild metadata for" << atom << version << "in" << repoPath;
     }
     
-    // Read metadata.xml for descriptions
-    QString metadataPath = QStringLiteral("%1/%2/metadata.xml").arg(repoPath, atom);
-    info.descriptions = parseMetadataXml(metadataPath);
+    // Read metadata.xml for descriptions, the package page has usually parsed it already
+    info.descriptions = PortageMetadataXml::instance().record(repoPath + QLatin1Char('/') + atom).flagDescriptions;
     
     qDebug() << "PortageUseFlags: Read repository package info for" << atom << version
              << "- Available:" << info.availableFlags.size()
              << "- Descriptions:" << info.descriptions.size();
     
+    infoCache.insert(atom, version, repoPath, info, epoch);
+    
     return info;
 }
 
 PortageUseFlags::EffectiveUseFlags PortageUseFlags::computeEffectiveUseFlags(const QString &atom, const QString &version, bool isInstalled)
 {
+    return evaluateEffectiveUse(EffectiveUseRequest{atom, version, isInstalled});
+}
+
+QFuture<PortageUseFlags::EffectiveUseFlags> PortageUseFlags::computeEffectiveUseFlagsBatch(const QList<EffectiveUseRequest> &requests)
+{
+    // Build the shared state once up front instead of letting the first workers queue on it
+    PortageProfileStack::instance().profiles();
+    PortageConfigIndex::instance().entries(PortageConfigIndex::PackageUse);
+    
+    qDebug() << "PortageUseFlags: Computing effective USE flags for" << requests.size() << "packages";
+    return QtConcurrent::mapped(requests, &PortageUseFlags::evaluateEffectiveUse);
+}
+
+PortageUseFlags::EffectiveUseFlags PortageUseFlags::evaluateEffectiveUse(const EffectiveUseRequest &request)
+{
+    const QString &atom = request.atom;
+    const QString &version = request.version;
+    
     EffectiveUseFlags result;
+    result.atom = atom;
+    result.version = version;
     
     // Find repository location for the package
     QString foundRepo = PortageRepositoryReader::findPackageRepository(atom);
@@ -499,83 +455,50 @@ PortageUseFlags::EffectiveUseFlags PortageUseFlags::computeEffectiveUseFlags(con
     result.iuse = repoInfo.availableFlags;
     result.descriptions = repoInfo.descriptions;
     
-    // 2. Start with global USE flags from make.conf
-    MakeConfReader makeConf;
-    QStringList globalUse = makeConf.readGlobalUseFlags();
-    QStringList globalL10n = makeConf.readL10N();
+    // 2. Profile stack and make.conf: IUSE defaults, USE, USE_EXPAND and profile package.use
+    PortageProfileStack &profile = PortageProfileStack::instance();
+    const QString arch = profile.value(QStringLiteral("ARCH"));
+    const QStringList keywords = PortageMetadataCache::instance().metadata(repoPath, atom, version).keywords
+                                     .split(QLatin1Char(' '), Qt::SkipEmptyParts);
+    const bool stable = !arch.isEmpty() && keywords.contains(arch);
+    const PortageProfileStack::PackageUse profileUse =
+        profile.packageUse(atom, version, repoInfo.slot, foundRepo, repoInfo.rawIuse, stable);
+    UseFlagSet enabled = profileUse.enabled;
+    
+    // 3. Apply every matching /etc/portage/package.use entry (versioned, slotted, wildcards) in file order
+    const QList<PortageConfigIndex::Entry> packageUse =
+        PortageConfigIndex::instance().entriesFor(PortageConfigIndex::PackageUse, atom);
+    for (const PortageConfigIndex::Entry &entry : packageUse) {
+        if (entry.spec.isValid() && entry.spec.matches(atom, version, repoInfo.slot, foundRepo)) {
+            applyPackageUseTokens(enabled, entry.values);
+        }
+    }
+    
+    // 4. use.force and use.mask win over any configuration, masks over forces
+    enabled |= profileUse.forced;
+    enabled.subtract(profileUse.masked);
     
     QSet<QString> enabledSet;
     QSet<QString> disabledSet;
-    
-    for (const QString &flag : globalUse) {
-        if (flag.startsWith(QLatin1Char('-'))) {
-            disabledSet.insert(flag.mid(1));
-        } else {
+    for (const QString &flag : std::as_const(result.iuse)) {
+        if (enabled.contains(flag)) {
             enabledSet.insert(flag);
-        }
-    }
-    
-    // 3. Apply IUSE defaults (flags with +/- prefix from portageq)
-    // But SKIP L10N flags - they should only be enabled if in L10N variable
-    for (const QString &rawFlag : repoInfo.rawIuse) {
-        QString cleanFlag;
-        bool isDefault = false;
-        bool isDisabled = false;
-        
-        if (rawFlag.startsWith(QLatin1Char('+'))) {
-            cleanFlag = rawFlag.mid(1);
-            isDefault = true;
-        } else if (rawFlag.startsWith(QLatin1Char('-'))) {
-            cleanFlag = rawFlag.mid(1);
-            isDisabled = true;
         } else {
-            cleanFlag = rawFlag;
+            disabledSet.insert(flag);
         }
-        
-        // Special handling for L10N flags
-        if (cleanFlag.startsWith(QStringLiteral("l10n_"))) {
-            // L10N flags are ONLY enabled if they're in global L10N variable
-            if (globalL10n.contains(cleanFlag)) {
-                enabledSet.insert(cleanFlag);
-                disabledSet.remove(cleanFlag);
-            } else {
-                // Not in L10N - disable it
-                disabledSet.insert(cleanFlag);
-                enabledSet.remove(cleanFlag);
-            }
-        } else {
-            // Regular flags - apply IUSE defaults
-            if (isDefault) {
-                enabledSet.insert(cleanFlag);
-                disabledSet.remove(cleanFlag);
-            } else if (isDisabled) {
-                disabledSet.insert(cleanFlag);
-                enabledSet.remove(cleanFlag);
-            }
-        }
-    }
-    
-    // 4. Apply package-specific USE from package.use files
-    QMap<QString, QStringList> packageUse = readPackageUseConfig(atom);
-    for (const QStringList &flags : packageUse) {
-        for (const QString &flag : flags) {
-            if (flag.startsWith(QLatin1Char('-'))) {
-                QString cleanFlag = flag.mid(1);
-                disabledSet.insert(cleanFlag);
-                enabledSet.remove(cleanFlag);
-            } else {
-                enabledSet.insert(flag);
-                disabledSet.remove(flag);
-            }
+        if (profileUse.masked.contains(flag)) {
+            result.masked << flag;
+        } else if (profileUse.forced.contains(flag)) {
+            result.forced << flag;
         }
     }
     
     // 5. If package is installed, use its actual USE flags as final state
-    if (isInstalled) {
-        UseFlagInfo installedInfo = readInstalledPackageInfo(atom, version);
-        if (!installedInfo.activeFlags.isEmpty()) {
+    if (request.installed) {
+        const QStringList activeFlags = readInstalledPackageInfo(atom, version).activeFlags;
+        if (!activeFlags.isEmpty()) {
             // The installed USE flags are the final truth
-            QSet<QString> installedSet(installedInfo.activeFlags.begin(), installedInfo.activeFlags.end());
+            QSet<QString> installedSet(activeFlags.begin(), activeFlags.end());
             
             // All IUSE flags not in installed set are disabled
             enabledSet = installedSet;
@@ -599,10 +522,6 @@ PortageUseFlags::EffectiveUseFlags PortageUseFlags::computeEffectiveUseFlags(con
     result.enabled = enabledIuseSet.values();
     result.disabled = disabledIuseSet.values();
     
-    qDebug() << "PortageUseFlags: computeEffectiveUseFlags for" << atom << version
-             << "- Enabled:" << result.enabled.size() << "Disabled:" << result.disabled.size()
-             << "- IUSE:" << result.iuse.size();
-    
     return result;
 }
 
@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <QFuture>
 #include <QObject>
 #include <QString>
 #include <QStringList>
@@ -32,27 +33,45 @@ public:
     explicit PortageUseFlags(QObject *parent = nullptr);
     ~PortageUseFlags() override;
 
-    UseFlagInfo readInstalledPackageInfo(const QString &atom, const QString &version);
+    // Installed and repository records are shared process-wide through UseFlagInfoCache
+    static UseFlagInfo readInstalledPackageInfo(const QString &atom, const QString &version);
 
     QStringList readAvailableUseFlags(const QString &atom, const QString &repoPath);
     
     // Read USE flags from repository ebuild and metadata.xml
-    UseFlagInfo readRepositoryPackageInfo(const QString &atom, const QString &version, const QString &repoPath);
+    static UseFlagInfo readRepositoryPackageInfo(const QString &atom, const QString &version, const QString &repoPath);
 
     // Compute effective USE flags by combining:
-    // 1. Global USE from make.conf
-    // 2. IUSE defaults from ebuild
+    // 1. IUSE defaults from ebuild
+    // 2. Profile stack and make.conf USE (PortageProfileStack)
     // 3. package.use configurations
-    // 4. Installed package USE (if package is installed)
+    // 4. use.force / use.mask of the profile stack
+    // 5. Installed package USE (if package is installed)
     struct EffectiveUseFlags {
+        QString atom;
+        QString version;
         QStringList enabled;      // Flags that will be enabled
         QStringList disabled;     // Flags that will be disabled
         QStringList iuse;         // All available flags from IUSE
+        QStringList forced;       // IUSE flags the profile forces on
+        QStringList masked;       // IUSE flags the profile masks
         QMap<QString, QString> descriptions;
     };
     EffectiveUseFlags computeEffectiveUseFlags(const QString &atom, const QString &version, bool isInstalled);
 
-    QMap<QString, QStringList> readPackageUseConfig(const QString &atom);
+    struct EffectiveUseRequest {
+        QString atom;
+        QString version;
+        bool installed = false; // report the USE the installed version was built with
+    };
+
+    // Effective USE of many packages on the global thread pool. Profile stack, make.conf
+    // and package.* indexes are shared by all of them; each result is reported to the
+    // future as soon as its package is done (QFutureWatcher::resultReadyAt, request index).
+    // Needs no QObject, so it can run from the update preview as well as a command line tool.
+    static QFuture<EffectiveUseFlags> computeEffectiveUseFlagsBatch(const QList<EffectiveUseRequest> &requests);
+
+    static QMap<QString, QStringList> readPackageUseConfig(const QString &atom);
 
     bool writeUseFlags(const QString &atom, const QString &packageName, const QStringList &useFlags);
 
@@ -66,18 +85,16 @@ public:
 
     static QStringList parseUSE(const QString &useLine);
     
-    static QMap<QString, QString> parseMetadataXml(const QString &metadataPath);
-    
     // Helper methods for atom parsing
     static QString extractCategory(const QString &atom);
     static QString extractPackageName(const QString &atom);
 
 private:
-    QString readVarDbFile(const QString &atom, const QString &version, const QString &filename);
+    static EffectiveUseFlags evaluateEffectiveUse(const EffectiveUseRequest &request);
+
+    static QString readVarDbFile(const QString &atom, const QString &version, const QString &filename);
 
     QStringList findPackageUseFiles(const QString &atom);
 
     bool removeLinesFromFile(const QString &filePath, const QString &atom);
-
-    QMap<QString, UseFlagInfo> m_cache;
 };
@@ -8,7 +8,7 @@
 #include "../backend/PortageBackend.h"
 #include "../emerge/EmergeRunner.h"
 #include "../emerge/UnmaskManager.h"
-#include "../installed/PortageInstalledReader.h"
+#include "../utils/AtomParser.h"
 #include <KLocalizedString>
 #include <QTimer>
 #include <QPointer>
@@ -121,46 +121,30 @@ void PortageTransaction::onEmergeFinished(bool success, int exitCode)
     qDebug() << "Portage: Emerge finished, success:" << success << "exitCode:" << exitCode;
     
     if (success) {
-        if (role() == InstallRole) {
-            QPointer<PortageResource> res = m_resource;
-            QTimer::singleShot(500, [res]() {
-                if (!res) {
-                    qWarning() << "Portage: Resource was deleted before delayed reload";
-                    return;
-                }
-                
-                QString atom = res->atom();
-                if (PortageInstalledReader::packageExists(atom)) {
-                    qDebug() << "Portage: Package" << atom << "was installed successfully";
-                    res->setState(AbstractResource::Installed);
-                    res->loadUseFlagInfo();
-                    qDebug() << "Portage: Installation completed for" << res->packageName();
-                } else {
-                    qWarning() << "Portage: Package" << atom << "was not found after installation";
-                    res->setState(AbstractResource::None);
-                }
-            });
-            
+        // emerge has returned, so /var/db/pkg is final: update right away instead of
+        // waiting for the vdb watcher (which then finds nothing left to do)
+        QPointer<PortageResource> res = m_resource;
+        auto *backend = qobject_cast<PortageBackend *>(m_resource->backend());
+        if (backend) {
+            backend->refreshInstalledCategories({AtomParser::extractCategory(m_resource->atom())});
+        }
+        
+        if (!res) {
+            qWarning() << "Portage: Resource was deleted before the installed state was refreshed";
+        } else if (role() == InstallRole) {
+            if (res->state() == AbstractResource::Installed) {
+                qDebug() << "Portage: Installation completed for" << res->packageName();
+                res->loadUseFlagInfo();
+            } else {
+                qWarning() << "Portage: Package" << res->atom() << "was not found after installation";
+            }
         } else if (role() == RemoveRole) {
-            QPointer<PortageResource> res = m_resource;
-            QTimer::singleShot(500, [res]() {
-                if (!res) {
-                    qWarning() << "Portage: Resource was deleted before delayed removal check";
-                    return;
-                }
-                
-                QString atom = res->atom();
-                if (!PortageInstalledReader::packageExists(atom)) {
-                    qDebug() << "Portage: Package" << atom << "was removed successfully";
-                    res->setState(AbstractResource::None);
-                    res->setInstalledVersion(QString());
-                    res->loadUseFlagInfo();
-                    qDebug() << "Portage: Removal completed for" << res->packageName();
-                } else {
-                    qWarning() << "Portage: Package" << atom << "still exists after removal attempt";
-                    res->setState(AbstractResource::Installed);
-                }
-            });
+            if (res->state() == AbstractResource::None) {
+                qDebug() << "Portage: Removal completed for" << res->packageName();
+                res->loadUseFlagInfo();
+            } else {
+                qWarning() << "Portage: Package" << res->atom() << "still exists after removal attempt";
+            }
         }
         setStatus(DoneStatus);
     } else {
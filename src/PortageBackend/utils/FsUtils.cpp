@@ -0,0 +1,124 @@
+/*
+ * SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include "FsUtils.h"
+
+#include <QFile>
+
+#include <cerrno>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace FsUtils
+{
+
+int openDirectory(const QString &path)
+{
+    return ::open(QFile::encodeName(path).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+int openDirectoryAt(int parentFd, const QString &name)
+{
+    return ::openat(parentFd, QFile::encodeName(name).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+QStringList listDirectory(int dirFd, EntryType type)
+{
+    QStringList result;
+    if (dirFd < 0) {
+        return result;
+    }
+
+    // fdopendir() takes ownership of the descriptor, keep the caller's one open
+    const int fd = ::dup(dirFd);
+    if (fd < 0) {
+        return result;
+    }
+
+    DIR *dir = ::fdopendir(fd);
+    if (!dir) {
+        ::close(fd);
+        return result;
+    }
+    ::rewinddir(dir);
+
+    const unsigned char wanted = type == EntryType::Directories ? DT_DIR : DT_REG;
+    while (const struct dirent *entry = ::readdir(dir)) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+
+        unsigned char entryType = entry->d_type;
+        if (entryType == DT_UNKNOWN || entryType == DT_LNK) {
+            struct stat st;
+            if (::fstatat(::dirfd(dir), entry->d_name, &st, 0) != 0) {
+                continue;
+            }
+            entryType = S_ISDIR(st.st_mode) ? DT_DIR : (S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN);
+        }
+
+        if (entryType == wanted) {
+            result << QFile::decodeName(entry->d_name);
+        }
+    }
+
+    ::closedir(dir);
+    return result;
+}
+
+QStringList listDirectory(const QString &path, EntryType type)
+{
+    const int fd = openDirectory(path);
+    if (fd < 0) {
+        return QStringList();
+    }
+    const QStringList result = listDirectory(fd, type);
+    ::close(fd);
+    return result;
+}
+
+QByteArray readFileAt(int dirFd, const char *name)
+{
+    const int fd = ::openat(dirFd, name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return QByteArray();
+    }
+
+    // vdb and md5-cache entries are tiny, a single pread usually covers the whole file
+    QByteArray result;
+    char buffer[4096];
+    off_t offset = 0;
+    for (;;) {
+        const ssize_t n = ::pread(fd, buffer, sizeof(buffer), offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        result.append(buffer, n);
+        offset += n;
+        if (size_t(n) < sizeof(buffer)) {
+            break;
+        }
+    }
+
+    ::close(fd);
+    return result;
+}
+
+qint64 modificationTime(const QString &path)
+{
+    struct stat st;
+    if (::stat(QFile::encodeName(path).constData(), &st) != 0) {
+        return -1;
+    }
+    return qint64(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+}
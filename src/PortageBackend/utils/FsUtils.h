@@ -0,0 +1,37 @@
+/*
+ * SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ * SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+/**
+ * Thin wrappers around openat()/readdir() for scanning large directory trees
+ * (repositories, /var/db/pkg) without building QFileInfo lists. Entry types
+ * come from d_type, stat is only used when the filesystem doesn't report it.
+ * Hidden entries (".", "..", ".git", ...) are always skipped.
+ */
+namespace FsUtils
+{
+    enum class EntryType {
+        Directories,
+        Files,
+    };
+
+    // Returns a directory descriptor or -1, caller must close() it
+    int openDirectory(const QString &path);
+    int openDirectoryAt(int parentFd, const QString &name);
+
+    QStringList listDirectory(int dirFd, EntryType type);
+    QStringList listDirectory(const QString &path, EntryType type);
+
+    // Whole content of a small file relative to dirFd (openat + pread), empty if missing
+    QByteArray readFileAt(int dirFd, const char *name);
+
+    // mtime of a file or directory in nanoseconds, -1 if it doesn't exist
+    qint64 modificationTime(const QString &path);
+}
@@ -0,0 +1,94 @@
+/*
+ *   SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include "FuzzyMatcher.h"
+
+#include <algorithm>
+
+FuzzyMatcher::FuzzyMatcher(QStringView pattern)
+{
+    if (pattern.isEmpty() || pattern.size() > MAX_PATTERN_LENGTH) {
+        return;
+    }
+    m_length = int(pattern.size());
+
+    for (int i = 0; i < m_length; ++i) {
+        const char16_t c = pattern.at(i).toCaseFolded().unicode();
+        const quint64 bit = quint64(1) << i;
+        if (c < 128) {
+            m_ascii[c] |= bit;
+            continue;
+        }
+        auto it = std::find_if(m_other.begin(), m_other.end(), [c](const auto &entry) {
+            return entry.first == c;
+        });
+        if (it != m_other.end()) {
+            it->second |= bit;
+        } else {
+            m_other.append(qMakePair(c, bit));
+        }
+    }
+}
+
+quint64 FuzzyMatcher::matchMask(QChar c) const
+{
+    const char16_t folded = c.toCaseFolded().unicode();
+    if (folded < 128) {
+        return m_ascii[folded];
+    }
+    for (const auto &entry : m_other) {
+        if (entry.first == folded) {
+            return entry.second;
+        }
+    }
+    return 0;
+}
+
+int FuzzyMatcher::distance(QStringView text, int maxDistance) const
+{
+    if (!isValid()) {
+        return maxDistance + 1;
+    }
+    const qsizetype textLength = text.size();
+    if (qAbs(textLength - m_length) > maxDistance) {
+        return maxDistance + 1;
+    }
+
+    // Vertical deltas of the DP column: all +1 against the empty prefix
+    const quint64 last = quint64(1) << (m_length - 1);
+    quint64 vp = ~quint64(0);
+    quint64 vn = 0;
+    quint64 d0 = 0;
+    quint64 prevEq = 0;
+    int score = m_length;
+
+    for (qsizetype j = 0; j < textLength; ++j) {
+        const quint64 eq = matchMask(text.at(j));
+
+        // Diagonal zero deltas, the first term allows swapping two neighbours
+        d0 = ((((~d0) & eq) << 1) & prevEq) | (((eq & vp) + vp) ^ vp) | eq | vn;
+        const quint64 hp = vn | ~(d0 | vp);
+        const quint64 hn = vp & d0;
+
+        if (hp & last) {
+            ++score;
+        } else if (hn & last) {
+            --score;
+        }
+
+        // Each remaining character lowers the distance by one at most
+        if (score - (textLength - j - 1) > maxDistance) {
+            return maxDistance + 1;
+        }
+
+        // Shifting in a one: row 0 of the table grows with the text (global alignment)
+        const quint64 x = (hp << 1) | 1;
+        vn = x & d0;
+        vp = (hn << 1) | ~(x | d0);
+        prevEq = eq;
+    }
+
+    return score <= maxDistance ? score : maxDistance + 1;
+}
@@ -0,0 +1,42 @@
+/*
+ *   SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#pragma once
+
+#include <QPair>
+#include <QString>
+#include <QVarLengthArray>
+
+/**
+ * @brief Bounded edit distance against a fixed pattern
+ *
+ * Bit-parallel (Myers / Hyyrö) computation of the optimal string alignment
+ * distance: insertions, deletions, substitutions and transpositions of
+ * adjacent characters all cost one. The pattern lives in a single 64-bit
+ * word, so a text is processed one character per handful of word
+ * operations, and gives up as soon as the distance can no longer stay
+ * within the bound. Comparison is case-insensitive.
+ */
+class FuzzyMatcher
+{
+public:
+    static constexpr int MAX_PATTERN_LENGTH = 64;
+
+    explicit FuzzyMatcher(QStringView pattern);
+
+    // False for empty patterns and ones longer than MAX_PATTERN_LENGTH
+    bool isValid() const { return m_length > 0; }
+    int patternLength() const { return m_length; }
+
+    // Distance to text, or maxDistance + 1 if it is larger than maxDistance
+    int distance(QStringView text, int maxDistance) const;
+
+private:
+    quint64 matchMask(QChar c) const;
+
+    int m_length = 0;
+    quint64 m_ascii[128] = {}; // pattern positions per ASCII character
+    QVarLengthArray<QPair<char16_t, quint64>, 4> m_other; // everything else, rare in atoms
+};
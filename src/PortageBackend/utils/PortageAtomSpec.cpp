@@ -0,0 +1,161 @@
+/*
+ *   SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include "PortageAtomSpec.h"
+
+#include <QRegularExpression>
+
+PortageAtomSpec PortageAtomSpec::parse(QStringView spec)
+{
+    PortageAtomSpec result;
+
+    spec = spec.trimmed();
+    if (spec.isEmpty() || spec.startsWith(QLatin1Char('!'))) {
+        return result;
+    }
+
+    // Operator
+    Operator op = NoOperator;
+    if (spec.startsWith(QLatin1String("<="))) {
+        op = LessEqual;
+    } else if (spec.startsWith(QLatin1String(">="))) {
+        op = GreaterEqual;
+    } else if (spec.startsWith(QLatin1Char('<'))) {
+        op = Less;
+    } else if (spec.startsWith(QLatin1Char('>'))) {
+        op = Greater;
+    } else if (spec.startsWith(QLatin1Char('='))) {
+        op = Equal;
+    } else if (spec.startsWith(QLatin1Char('~'))) {
+        op = Approximate;
+    }
+    spec = spec.sliced(op == LessEqual || op == GreaterEqual ? 2 : (op == NoOperator ? 0 : 1));
+
+    // ::repository and :slot
+    const qsizetype repoSep = spec.indexOf(QLatin1String("::"));
+    if (repoSep >= 0) {
+        result.m_repository = spec.sliced(repoSep + 2).toString();
+        spec = spec.first(repoSep);
+    }
+    const qsizetype slotSep = spec.indexOf(QLatin1Char(':'));
+    if (slotSep >= 0) {
+        result.m_slot = spec.sliced(slotSep + 1).toString();
+        spec = spec.first(slotSep);
+    }
+
+    // USE dependencies are meaningless in configuration files, but tolerated
+    const qsizetype useDep = spec.indexOf(QLatin1Char('['));
+    if (useDep >= 0) {
+        spec = spec.first(useDep);
+    }
+
+    const qsizetype slash = spec.indexOf(QLatin1Char('/'));
+    if (slash <= 0 || slash == spec.size() - 1) {
+        return result;
+    }
+
+    QStringView package = spec.sliced(slash + 1);
+    if (op != NoOperator) {
+        // The version starts at the last hyphen that is followed by a valid version
+        bool glob = false;
+        if (op == Equal && package.endsWith(QLatin1Char('*'))) {
+            glob = true;
+            package.chop(1);
+        }
+
+        qsizetype hyphen = package.lastIndexOf(QLatin1Char('-'));
+        while (hyphen > 0 && !PortageVersion::isValid(package.sliced(hyphen + 1))) {
+            hyphen = package.lastIndexOf(QLatin1Char('-'), hyphen - 1);
+        }
+        // A glob may stop in the middle of a version ("=foo-1.2*", "=foo-1*")
+        if (hyphen <= 0 && glob) {
+            hyphen = package.lastIndexOf(QLatin1Char('-'));
+            if (hyphen > 0 && (hyphen + 1 == package.size() || !package.at(hyphen + 1).isDigit())) {
+                hyphen = -1;
+            }
+        }
+        if (hyphen <= 0) {
+            return result;
+        }
+
+        result.m_versionString = package.sliced(hyphen + 1).toString();
+        result.m_version = PortageVersion(result.m_versionString);
+        package = package.first(hyphen);
+        op = glob ? EqualGlob : op;
+    }
+
+    result.m_op = op;
+    result.m_category = spec.first(slash).toString();
+    result.m_package = package.toString();
+    return result;
+}
+
+QString PortageAtomSpec::stripRevision(const QString &version)
+{
+    static const QRegularExpression revisionRe(QStringLiteral("-r\\d+$"));
+    QString result = version;
+    result.remove(revisionRe);
+    return result;
+}
+
+bool PortageAtomSpec::matchesAtom(const QString &atom) const
+{
+    const qsizetype slash = atom.indexOf(QLatin1Char('/'));
+    if (slash <= 0) {
+        return false;
+    }
+    const QStringView category = QStringView(atom).first(slash);
+    const QStringView package = QStringView(atom).sliced(slash + 1);
+    return (m_category == QLatin1Char('*') || category.compare(m_category, Qt::CaseInsensitive) == 0)
+        && (m_package == QLatin1Char('*') || package.compare(m_package, Qt::CaseInsensitive) == 0);
+}
+
+bool PortageAtomSpec::matchesVersion(const QString &version) const
+{
+    switch (m_op) {
+    case NoOperator:
+        return true;
+    case EqualGlob:
+        return version.startsWith(m_versionString);
+    case Approximate:
+        return PortageVersion(stripRevision(version)) == PortageVersion(stripRevision(m_versionString));
+    default:
+        break;
+    }
+
+    const int result = PortageVersion(version).compare(m_version);
+    switch (m_op) {
+    case Less:
+        return result < 0;
+    case LessEqual:
+        return result <= 0;
+    case Equal:
+        return result == 0;
+    case GreaterEqual:
+        return result >= 0;
+    case Greater:
+        return result > 0;
+    default:
+        return false;
+    }
+}
+
+bool PortageAtomSpec::matches(const QString &atom, const QString &version, const QString &slot,
+                              const QString &repository) const
+{
+    if (!isValid() || !matchesAtom(atom) || !matchesVersion(version)) {
+        return false;
+    }
+
+    if (!m_slot.isEmpty() && !slot.isEmpty()) {
+        // ":2" matches any sub-slot of slot 2, ":2/2.1" only that one
+        const QString wanted = m_slot.contains(QLatin1Char('/')) ? slot : slot.section(QLatin1Char('/'), 0, 0);
+        if (wanted != m_slot) {
+            return false;
+        }
+    }
+
+    return m_repository.isEmpty() || repository.isEmpty() || m_repository == repository;
+}
@@ -0,0 +1,67 @@
+/*
+ *   SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#pragma once
+
+#include <QString>
+
+#include "PortageVersion.h"
+
+/**
+ * @brief Package atom as written in package.mask, package.accept_keywords etc.
+ *
+ * [op]category/package[-version][*][:slot[/subslot]][::repository]
+ *
+ * Operators are <, <=, =, ~, >= and >, "=...*" matches a version prefix.
+ * As in Portage configuration files, category and package may be "*".
+ * Package names are matched case-insensitively, like everywhere else in
+ * the backend.
+ */
+class PortageAtomSpec
+{
+public:
+    enum Operator {
+        NoOperator,
+        Less,
+        LessEqual,
+        Equal,
+        EqualGlob,
+        Approximate, // same version, any revision
+        GreaterEqual,
+        Greater,
+    };
+
+    PortageAtomSpec() = default;
+
+    // Invalid (isValid() == false) for blockers and malformed entries
+    static PortageAtomSpec parse(QStringView spec);
+
+    bool isValid() const { return !m_category.isEmpty(); }
+    bool hasWildcard() const { return m_category == QLatin1Char('*') || m_package == QLatin1Char('*'); }
+
+    QString atom() const { return m_category + QLatin1Char('/') + m_package; }
+    Operator op() const { return m_op; }
+    QString version() const { return m_versionString; }
+    QString slot() const { return m_slot; }
+    QString repository() const { return m_repository; }
+
+    // An empty slot or repository is unknown and matches any restriction
+    bool matches(const QString &atom, const QString &version, const QString &slot = QString(),
+                 const QString &repository = QString()) const;
+
+    static QString stripRevision(const QString &version);
+
+private:
+    bool matchesAtom(const QString &atom) const;
+    bool matchesVersion(const QString &version) const;
+
+    Operator m_op = NoOperator;
+    QString m_category;
+    QString m_package;
+    QString m_versionString;
+    PortageVersion m_version;
+    QString m_slot;
+    QString m_repository;
+};
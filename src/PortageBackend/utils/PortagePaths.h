@@ -16,12 +16,20 @@ namespace PortagePaths
     constexpr const char* PACKAGE_USE = "/etc/portage/package.use";
     constexpr const char* PACKAGE_ACCEPT_KEYWORDS = "/etc/portage/package.accept_keywords";
     constexpr const char* PACKAGE_MASK = "/etc/portage/package.mask";
+    constexpr const char* PACKAGE_UNMASK = "/etc/portage/package.unmask";
     constexpr const char* PACKAGE_LICENSE = "/etc/portage/package.license";
+    constexpr const char* MAKE_PROFILE = "/etc/portage/make.profile";
+    constexpr const char* USER_PROFILE = "/etc/portage/profile";
     
     // Database paths
     constexpr const char* PKG_DB = "/var/db/pkg";
+    constexpr const char* PKG_COUNTER = "/var/cache/edb/counter";
     constexpr const char* WORLD_FILE = "/var/lib/portage/world";
     
+    // Repository files (relative to repository location)
+    constexpr const char* REPO_TIMESTAMP = "metadata/timestamp.chk";
+    constexpr const char* REPO_PACKAGE_MASK = "profiles/package.mask";
+    
     // Default repository
     constexpr const char* DEFAULT_REPO = "gentoo";
     
@@ -0,0 +1,227 @@
+/*
+ *   SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include "PortageVersion.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+// Key layout, compared bytewise:
+//   0x01 (valid)
+//   first component      number
+//   further components   0x01 <digits without trailing zeros> 0x00   if it starts with '0'
+//                        0x02 number                                 otherwise
+//   0x00                 end of components, below any further component
+//   letter               0x00 if absent
+//   suffixes             rank number, repeated
+//   SuffixEnd            between _rc and _p, so 1.0_rc1 < 1.0 < 1.0_p1
+//   revision             number, -r0 and no revision are the same
+// where number is a digit count followed by the digits, leading zeros stripped.
+enum : char {
+    InvalidMarker = 0x00,
+    ValidMarker = 0x01,
+    ComponentEnd = 0x00,
+    ZeroComponent = 0x01,
+    NumericComponent = 0x02,
+    SuffixAlpha = 0x01,
+    SuffixBeta = 0x02,
+    SuffixPre = 0x03,
+    SuffixRc = 0x04,
+    SuffixEnd = 0x05,
+    SuffixP = 0x06,
+};
+
+struct Suffix {
+    QLatin1String name;
+    char rank;
+};
+
+// Longest first so that _pre is not taken for _p
+const Suffix suffixes[] = {
+    {QLatin1String("alpha"), SuffixAlpha},
+    {QLatin1String("beta"), SuffixBeta},
+    {QLatin1String("pre"), SuffixPre},
+    {QLatin1String("rc"), SuffixRc},
+    {QLatin1String("p"), SuffixP},
+};
+
+bool isAsciiDigit(QChar c)
+{
+    return c >= QLatin1Char('0') && c <= QLatin1Char('9');
+}
+
+qsizetype digitsEnd(QStringView text, qsizetype pos)
+{
+    while (pos < text.size() && isAsciiDigit(text.at(pos))) {
+        ++pos;
+    }
+    return pos;
+}
+}
+
+PortageVersion::PortageVersion(QStringView version)
+{
+    m_valid = parse(version);
+    if (!m_valid) {
+        m_key.clear();
+        m_key.append(InvalidMarker);
+        const QByteArray text = version.toUtf8();
+        m_key.append(text.constData(), text.size());
+    }
+}
+
+void PortageVersion::appendNumber(QStringView digits)
+{
+    qsizetype start = 0;
+    while (start < digits.size() && digits.at(start) == QLatin1Char('0')) {
+        ++start;
+    }
+    const QStringView significant = digits.sliced(start);
+    m_key.append(char(significant.size()));
+    for (QChar c : significant) {
+        m_key.append(char(c.unicode()));
+    }
+}
+
+bool PortageVersion::parse(QStringView version)
+{
+    const qsizetype n = version.size();
+    qsizetype pos = digitsEnd(version, 0);
+    if (pos == 0 || pos > 255) {
+        return false;
+    }
+
+    m_key.append(ValidMarker);
+    appendNumber(version.first(pos));
+
+    // Numeric components
+    while (pos < n && version.at(pos) == QLatin1Char('.')) {
+        const qsizetype start = pos + 1;
+        const qsizetype end = digitsEnd(version, start);
+        if (end == start || end - start > 255) {
+            return false;
+        }
+        const QStringView component = version.sliced(start, end - start);
+        if (component.startsWith(QLatin1Char('0'))) {
+            // Compared as a string with trailing zeros stripped (1.01 < 1.1, 1.0 == 1.00)
+            qsizetype length = component.size();
+            while (length > 0 && component.at(length - 1) == QLatin1Char('0')) {
+                --length;
+            }
+            m_key.append(ZeroComponent);
+            for (QChar c : component.first(length)) {
+                m_key.append(char(c.unicode()));
+            }
+            m_key.append(ComponentEnd);
+        } else {
+            m_key.append(NumericComponent);
+            appendNumber(component);
+        }
+        pos = end;
+    }
+    m_key.append(ComponentEnd);
+
+    // Optional letter
+    if (pos < n && version.at(pos) >= QLatin1Char('a') && version.at(pos) <= QLatin1Char('z')) {
+        m_key.append(char(version.at(pos).unicode()));
+        ++pos;
+    } else {
+        m_key.append(char(0));
+    }
+
+    // Suffixes
+    while (pos < n && version.at(pos) == QLatin1Char('_')) {
+        ++pos;
+        const Suffix *found = nullptr;
+        for (const Suffix &suffix : suffixes) {
+            if (version.sliced(pos).startsWith(suffix.name)) {
+                found = &suffix;
+                break;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+        pos += found->name.size();
+        const qsizetype end = digitsEnd(version, pos);
+        if (end - pos > 255) {
+            return false;
+        }
+        m_key.append(found->rank);
+        appendNumber(version.sliced(pos, end - pos));
+        pos = end;
+    }
+    m_key.append(SuffixEnd);
+
+    // Revision
+    if (pos < n) {
+        if (!version.sliced(pos).startsWith(QLatin1String("-r"))) {
+            return false;
+        }
+        pos += 2;
+        const qsizetype end = digitsEnd(version, pos);
+        if (end == pos || end != n || end - pos > 255) {
+            return false;
+        }
+        appendNumber(version.sliced(pos));
+    } else {
+        appendNumber({});
+    }
+
+    return true;
+}
+
+int PortageVersion::compare(const PortageVersion &other) const
+{
+    const qsizetype common = qMin(m_key.size(), other.m_key.size());
+    const int result = std::memcmp(m_key.constData(), other.m_key.constData(), size_t(common));
+    if (result != 0) {
+        return result;
+    }
+    return m_key.size() < other.m_key.size() ? -1 : (m_key.size() > other.m_key.size() ? 1 : 0);
+}
+
+int PortageVersion::compare(QStringView a, QStringView b)
+{
+    return PortageVersion(a).compare(PortageVersion(b));
+}
+
+bool PortageVersion::isValid(QStringView version)
+{
+    return PortageVersion(version).isValid();
+}
+
+void PortageVersion::sortDescending(QStringList &versions)
+{
+    versions.removeDuplicates();
+
+    struct Entry {
+        PortageVersion version;
+        qsizetype index;
+    };
+    QList<Entry> entries;
+    entries.reserve(versions.size());
+    for (qsizetype i = 0; i < versions.size(); ++i) {
+        entries.append({PortageVersion(versions.at(i)), i});
+    }
+
+    std::sort(entries.begin(), entries.end(), [&versions](const Entry &a, const Entry &b) {
+        const int result = a.version.compare(b.version);
+        if (result != 0) {
+            return result > 0;
+        }
+        // Equal versions spelled differently (1.0 / 1.00): keep a stable order
+        return versions.at(a.index) > versions.at(b.index);
+    });
+
+    QStringList sorted;
+    sorted.reserve(versions.size());
+    for (const Entry &entry : entries) {
+        sorted << versions.at(entry.index);
+    }
+    versions = sorted;
+}
@@ -0,0 +1,56 @@
+/*
+ *   SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#pragma once
+
+#include <QByteArrayView>
+#include <QStringList>
+#include <QVarLengthArray>
+
+/**
+ * @brief Package version ordered as the Package Manager Specification says
+ *
+ * The version string is parsed once into a byte key. Comparing two keys
+ * with memcmp gives the PMS order: 1.9 < 1.10 < 1.10a, _alpha < _beta <
+ * _pre < _rc < (release) < _p, and -r revisions last. Numbers are stored
+ * as length-prefixed digits, so dates and other long components neither
+ * overflow nor need big-integer arithmetic. The key lives in inline
+ * storage, so typical versions don't allocate.
+ *
+ * Strings that are not valid versions get a key that sorts below every
+ * valid version, ordered by their text.
+ */
+class PortageVersion
+{
+public:
+    PortageVersion() = default;
+    explicit PortageVersion(QStringView version);
+
+    bool isValid() const { return m_valid; }
+    QByteArrayView key() const { return QByteArrayView(m_key.constData(), m_key.size()); }
+
+    int compare(const PortageVersion &other) const;
+
+    friend bool operator==(const PortageVersion &a, const PortageVersion &b) { return a.compare(b) == 0; }
+    friend bool operator!=(const PortageVersion &a, const PortageVersion &b) { return a.compare(b) != 0; }
+    friend bool operator<(const PortageVersion &a, const PortageVersion &b) { return a.compare(b) < 0; }
+    friend bool operator>(const PortageVersion &a, const PortageVersion &b) { return a.compare(b) > 0; }
+    friend bool operator<=(const PortageVersion &a, const PortageVersion &b) { return a.compare(b) <= 0; }
+    friend bool operator>=(const PortageVersion &a, const PortageVersion &b) { return a.compare(b) >= 0; }
+
+    // <0, 0 or >0 like strcmp; "1.0" and "1.00" compare equal, as in Portage
+    static int compare(QStringView a, QStringView b);
+    static bool isValid(QStringView version);
+
+    // Newest first, exact duplicates removed; every version is parsed once
+    static void sortDescending(QStringList &versions);
+
+private:
+    bool parse(QStringView version);
+    void appendNumber(QStringView digits);
+
+    QVarLengthArray<char, 40> m_key;
+    bool m_valid = false;
+};
@@ -0,0 +1,59 @@
+/*
+ *   SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include "UseFlagDictionary.h"
+
+UseFlagDictionary &UseFlagDictionary::instance()
+{
+    static UseFlagDictionary inst;
+    return inst;
+}
+
+UseFlagDictionary::UseFlagDictionary()
+{
+    // The main repository alone declares a few thousand distinct flags
+    m_names.reserve(4096);
+    m_ids.reserve(4096);
+}
+
+int UseFlagDictionary::intern(const QString &flag)
+{
+    {
+        QReadLocker locker(&m_lock);
+        const auto it = m_ids.constFind(flag);
+        if (it != m_ids.constEnd()) {
+            return it.value();
+        }
+    }
+
+    QWriteLocker locker(&m_lock);
+    // Another thread may have added it between the two locks
+    const auto it = m_ids.constFind(flag);
+    if (it != m_ids.constEnd()) {
+        return it.value();
+    }
+    const int id = int(m_names.size());
+    m_names << flag;
+    m_ids.insert(flag, id);
+    return id;
+}
+
+int UseFlagDictionary::find(const QString &flag) const
+{
+    QReadLocker locker(&m_lock);
+    return m_ids.value(flag, -1);
+}
+
+QString UseFlagDictionary::name(int id) const
+{
+    QReadLocker locker(&m_lock);
+    return m_names.value(id);
+}
+
+int UseFlagDictionary::size() const
+{
+    QReadLocker locker(&m_lock);
+    return int(m_names.size());
+}
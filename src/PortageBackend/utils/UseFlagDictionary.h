@@ -0,0 +1,40 @@
+/*
+ *   SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#pragma once
+
+#include <QHash>
+#include <QReadWriteLock>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief Process-wide intern table for USE flag names
+ *
+ * Every flag name is stored once and addressed by a small dense id, which
+ * is what UseFlagSet keeps per package. Ids are never reused or removed.
+ * Thread-safe.
+ */
+class UseFlagDictionary
+{
+public:
+    static UseFlagDictionary &instance();
+
+    // Id of a flag, adding it if it has not been seen yet
+    int intern(const QString &flag);
+
+    // Id of a known flag, -1 if it has never been interned
+    int find(const QString &flag) const;
+
+    QString name(int id) const;
+    int size() const;
+
+private:
+    UseFlagDictionary();
+
+    QStringList m_names;
+    QHash<QString, int> m_ids;
+    mutable QReadWriteLock m_lock;
+};
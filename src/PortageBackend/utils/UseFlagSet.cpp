@@ -0,0 +1,134 @@
+/*
+ *   SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include "UseFlagSet.h"
+#include "UseFlagDictionary.h"
+
+#include <bit>
+
+UseFlagSet UseFlagSet::fromFlags(const QStringList &flags)
+{
+    UseFlagDictionary &dict = UseFlagDictionary::instance();
+
+    UseFlagSet set;
+    for (const QString &flag : flags) {
+        if (!flag.isEmpty()) {
+            set.insert(dict.intern(flag));
+        }
+    }
+    return set;
+}
+
+void UseFlagSet::insert(int id)
+{
+    if (id < 0) {
+        return;
+    }
+    const qsizetype word = id >> 6;
+    if (word >= m_words.size()) {
+        m_words.resize(word + 1, 0);
+    }
+    m_words[word] |= quint64(1) << (id & 63);
+}
+
+void UseFlagSet::remove(int id)
+{
+    const qsizetype word = id >> 6;
+    if (id < 0 || word >= m_words.size()) {
+        return;
+    }
+    m_words[word] &= ~(quint64(1) << (id & 63));
+    trim();
+}
+
+bool UseFlagSet::contains(const QString &flag) const
+{
+    return contains(UseFlagDictionary::instance().find(flag));
+}
+
+int UseFlagSet::count() const
+{
+    int total = 0;
+    for (quint64 word : m_words) {
+        total += std::popcount(word);
+    }
+    return total;
+}
+
+bool UseFlagSet::intersects(const UseFlagSet &other) const
+{
+    const qsizetype n = qMin(m_words.size(), other.m_words.size());
+    for (qsizetype i = 0; i < n; ++i) {
+        if (m_words.at(i) & other.m_words.at(i)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+UseFlagSet &UseFlagSet::operator|=(const UseFlagSet &other)
+{
+    if (other.m_words.size() > m_words.size()) {
+        m_words.resize(other.m_words.size(), 0);
+    }
+    for (qsizetype i = 0; i < other.m_words.size(); ++i) {
+        m_words[i] |= other.m_words.at(i);
+    }
+    return *this;
+}
+
+UseFlagSet &UseFlagSet::operator&=(const UseFlagSet &other)
+{
+    m_words.resize(qMin(m_words.size(), other.m_words.size()));
+    for (qsizetype i = 0; i < m_words.size(); ++i) {
+        m_words[i] &= other.m_words.at(i);
+    }
+    trim();
+    return *this;
+}
+
+UseFlagSet &UseFlagSet::subtract(const UseFlagSet &other)
+{
+    const qsizetype n = qMin(m_words.size(), other.m_words.size());
+    for (qsizetype i = 0; i < n; ++i) {
+        m_words[i] &= ~other.m_words.at(i);
+    }
+    trim();
+    return *this;
+}
+
+QList<int> UseFlagSet::ids() const
+{
+    QList<int> result;
+    result.reserve(count());
+    for (qsizetype i = 0; i < m_words.size(); ++i) {
+        quint64 word = m_words.at(i);
+        while (word) {
+            result << int(i * 64 + std::countr_zero(word));
+            word &= word - 1;
+        }
+    }
+    return result;
+}
+
+QStringList UseFlagSet::toStringList() const
+{
+    const UseFlagDictionary &dict = UseFlagDictionary::instance();
+
+    QStringList result;
+    const QList<int> flagIds = ids();
+    result.reserve(flagIds.size());
+    for (int id : flagIds) {
+        result << dict.name(id);
+    }
+    return result;
+}
+
+void UseFlagSet::trim()
+{
+    while (!m_words.isEmpty() && m_words.constLast() == 0) {
+        m_words.removeLast();
+    }
+}
@@ -0,0 +1,55 @@
+/*
+ *   SPDX-FileCopyrightText: 2025 keklick1337 <gentoo@trustcrypt.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#pragma once
+
+#include <QList>
+#include <QStringList>
+
+/**
+ * @brief Set of USE flags as a bitset over UseFlagDictionary ids
+ *
+ * Grows on demand and never keeps trailing zero words, so equality is a
+ * plain word comparison. Set operations work a 64-bit word at a time.
+ */
+class UseFlagSet
+{
+public:
+    UseFlagSet() = default;
+
+    // Interns every name; leading '+' / '-' markers must be stripped by the caller
+    static UseFlagSet fromFlags(const QStringList &flags);
+
+    void insert(int id);
+    void remove(int id);
+    bool contains(int id) const
+    {
+        const qsizetype word = id >> 6;
+        return id >= 0 && word < m_words.size() && (m_words.at(word) >> (id & 63)) & 1;
+    }
+    bool contains(const QString &flag) const;
+
+    bool isEmpty() const { return m_words.isEmpty(); }
+    int count() const;
+    void clear() { m_words.clear(); }
+
+    bool intersects(const UseFlagSet &other) const;
+    UseFlagSet &operator|=(const UseFlagSet &other);
+    UseFlagSet &operator&=(const UseFlagSet &other);
+    UseFlagSet &subtract(const UseFlagSet &other);
+
+    friend UseFlagSet operator|(UseFlagSet a, const UseFlagSet &b) { return a |= b; }
+    friend UseFlagSet operator&(UseFlagSet a, const UseFlagSet &b) { return a &= b; }
+    friend bool operator==(const UseFlagSet &a, const UseFlagSet &b) { return a.m_words == b.m_words; }
+    friend bool operator!=(const UseFlagSet &a, const UseFlagSet &b) { return !(a == b); }
+
+    QList<int> ids() const;
+    QStringList toStringList() const; // in id order, not IUSE order
+
+private:
+    void trim();
+
+    QList<quint64> m_words;
+};